@@ -262,19 +262,51 @@ int example_gui(int argc, char **argv)
     get_param("lambda", par.lambda, argc, argv);
     get_param("alpha", par.alpha, argc, argv);
     get_param("temporal", par.temporal, argc, argv);
+    get_param("incremental", par.incremental, argc, argv);
+    get_param("incremental_eps", par.incremental_eps, argc, argv);
+    get_param("incremental_max_fraction", par.incremental_max_fraction, argc, argv);
     get_param("iterations", par.iterations, argc, argv);
     get_param("stop_eps", par.stop_eps, argc, argv);
     get_param("stop_k", par.stop_k, argc, argv);
+    get_param("time_budget", par.time_budget, argc, argv);
     get_param("adapt_params", par.adapt_params, argc, argv);
     get_param("weight", par.weight, argc, argv);
     get_param("edges", par.edges, argc, argv);
     get_param("use_double", par.use_double, argc, argv);
+    get_param("special_solvers", par.special_solvers, argc, argv);
+    {
+    	std::string s_batch_1d = "";
+        if (get_param("batch_1d", s_batch_1d, argc, argv))
+        {
+        	std::transform(s_batch_1d.begin(), s_batch_1d.end(), s_batch_1d.begin(), ::tolower);
+        	if (s_batch_1d.find("row") == 0)
+        	{
+        		par.batch_1d = Par::batch_1d_rows;
+        	}
+        	else if (s_batch_1d.find("col") == 0)
+        	{
+        		par.batch_1d = Par::batch_1d_columns;
+        	}
+        	else if (s_batch_1d.find("none") == 0)
+        	{
+        		par.batch_1d = Par::batch_1d_none;
+        	}
+        	else
+        	{
+        		get_param("batch_1d", par.batch_1d, argc, argv);
+        	}
+        }
+    }
     {
     	std::string s_engine = "";
         if (get_param("engine", s_engine, argc, argv))
         {
         	std::transform(s_engine.begin(), s_engine.end(), s_engine.begin(), ::tolower);
-        	if (s_engine.find("cpu") == 0 || s_engine.find("host") == 0)
+        	if (s_engine.find("admm") != std::string::npos)
+        	{
+        		par.engine = Par::engine_cpu_admm;
+        	}
+        	else if (s_engine.find("cpu") == 0 || s_engine.find("host") == 0)
         	{
         		par.engine = Par::engine_cpu;
         	}
@@ -73,6 +73,26 @@ int example_volumes(int argc, char **argv)
         	}
         }
     }
+    {
+    	std::string s_layout = "";
+        if (get_param("layout", s_layout, argc, argv))
+        {
+        	std::transform(s_layout.begin(), s_layout.end(), s_layout.begin(), ::tolower);
+        	if (s_layout.find("brick") == 0)
+        	{
+        		par.layout = Par3::layout_bricked;
+        	}
+        	else if (s_layout.find("layer") == 0)
+        	{
+        		par.layout = Par3::layout_layered;
+        	}
+        	else
+        	{
+        		get_param("layout", par.layout, argc, argv);
+        	}
+        }
+    }
+    get_param("sparse", par.sparse, argc, argv);
     get_param("edges", par.edges, argc, argv);
     if (par.verbose) { par.print(); }
     std::cout << std::endl;
@@ -109,9 +129,38 @@ int example_volumes(int argc, char **argv)
     	inputfiles.push_back(default_file);
     }
     
+    // .fmsv volumes: solved directly from the mapped file (without a copy for float volumes), the result is written into a mapped .fmsv file
+    Solver3 solver;
+    int num_mapped = 0;
+	for (int i = 0; i < (int)inputfiles.size(); i++)
+	{
+		if (!FilesUtil::has_extension(inputfiles[i], "fmsv") || slice2d >= 0) { continue; }
+		num_mapped++;
+		MappedVolume input_volume;
+		if (!input_volume.open(inputfiles[i])) { std::cerr << "ERROR: Could not load volume " << inputfiles[i].c_str() << std::endl; continue; }
+    	if (par.verbose) std::cout << inputfiles[i].c_str() << ":  ";
+		if (!save_result)
+		{
+			delete solver.run(&input_volume, par);
+			continue;
+		}
+        std::string dir;
+        std::string basename;
+        FilesUtil::to_dir_basename(inputfiles[i], dir, basename);
+        std::string out_dir = save_dir + '/' + dir;
+        if (!FilesUtil::mkdir(out_dir)) { std::cerr << "ERROR: Could not create output directory " << out_dir.c_str() << std::endl; continue; }
+        std::string out_file_result = out_dir + '/' + basename + "__result" + par_to_string(par) + ".fmsv";
+        MappedVolume result_volume;
+        if (!result_volume.create(out_file_result, input_volume.dim(), input_volume.elem_kind())) { std::cerr << "ERROR: Could not save result volume " << out_file_result.c_str() << std::endl; continue; }
+        solver.run_into(&result_volume, &input_volume, par);
+        std::cout << "SAVED RESULT: " << out_file_result.c_str() << std::endl;
+	}
+    if (num_mapped == (int)inputfiles.size()) { return 0; }
+
 	if (par.verbose) std::cout << "loading input files" << std::endl;
 	for (int i = 0; i < (int)inputfiles.size(); i++)
 	{
+		if (FilesUtil::has_extension(inputfiles[i], "fmsv") && slice2d < 0) { continue; }
 		VolMat input_volume = volread(inputfiles[i].c_str(), true);
 		if (input_volume.data.empty()) { std::cerr << "ERROR: Could not load volume " << inputfiles[i].c_str() << std::endl; continue; }
 		input_volumes.push_back(input_volume);
@@ -134,7 +183,6 @@ int example_volumes(int argc, char **argv)
 
     // process
     std::vector<VolMat> result_volumes(input_volumes.size());
-    Solver3 solver;
     for (int i = 0; i < (int)input_volumes.size(); i++)
     {
     	if (par.verbose) std::cout << input_names[i].c_str() << ":  ";
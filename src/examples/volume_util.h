@@ -27,6 +27,7 @@
 #include <fstream> 
 #include "solver/volume_solver.h"
 #include "util/volume_mat.h"
+#include "util/volume_mapped.h"
 
 
 class FilesUtil
@@ -61,6 +62,13 @@ public:
 		}
 	}
 
+	static bool has_extension(const std::string filename, const std::string ext)
+	{
+		std::string dir, basename, file_ext;
+		to_dir_basename_ext(filename, dir, basename, file_ext);
+		return (file_ext == ext);
+	}
+
 	static bool mkdir(const std::string dir)
 	{
 		return (system(("mkdir -p " + dir).c_str()) == 0);
@@ -100,8 +108,21 @@ std::string inline str_curtime()
 	return std::string(buffer);
 }
 
+// Reads a .dat volume: the header w h d num_channels and the voxel values (0..255), as whitespace-separated text or binary,
+// or a .fmsv volume (see MappedVolume), converted to unsigned char.
 VolMat volread(const char* filename, const bool text = 0)
 {
+	if (FilesUtil::has_extension(filename, "fmsv"))
+	{
+		MappedVolume mapped_volume;
+		if (!mapped_volume.open(filename)) { return VolMat(); }
+		VolumeUntypedAccess<DataInterpretationLayered> view;
+		mapped_volume.get_layered_view(&view);
+		MatVolume mat_volume(mapped_volume.dim(), VolDepth::value);
+		mat_volume.copy_from_layered(view);
+		return mat_volume.get_mat();
+	}
+
 	std::ifstream rf(filename, text ? std::ios::in : std::ios::binary);
 
 	if(!rf)
@@ -122,8 +143,8 @@ VolMat volread(const char* filename, const bool text = 0)
 	}
 
 	VolMat volume = VolMat(dim, VolDepth::value);
-	if(text) for(size_t i = 0; i < dim.num_elem(); i++) rf >> volume.data[i];
-	else rf.read((char *) &volume.data, sizeof(unsigned char) * dim.num_elem());
+	if(text) for(size_t i = 0; i < dim.num_elem(); i++) { int val = 0; rf >> val; volume.data[i] = (unsigned char)val; }
+	else if (dim.num_elem() > 0) rf.read((char *) &volume.data[0], sizeof(unsigned char) * dim.num_elem());
 
 	if(!rf.good()) 
 	{
@@ -139,6 +160,16 @@ VolMat volread(const char* filename, const bool text = 0)
 
 bool volwrite(const char* filename, const VolMat& volume)
 {
+	if (FilesUtil::has_extension(filename, "fmsv"))
+	{
+		MappedVolume mapped_volume;
+		if (!mapped_volume.create(filename, volume.dim, elem_kind_uchar)) { return false; }
+		VolumeUntypedAccess<DataInterpretationLayered> view;
+		mapped_volume.get_layered_view(&view);
+		MatVolume(volume).copy_to_layered(view);
+		return true;
+	}
+
 	std::ofstream wf(filename, std::ios::out | std::ios::binary);
 	if(!wf)
 	{
@@ -147,7 +178,7 @@ bool volwrite(const char* filename, const VolMat& volume)
 	}
 
 	wf.write((char *) &volume.dim, sizeof(ArrayDim3));
-	wf.write((char *) &volume.data, sizeof(unsigned char) * volume.dim.num_elem());
+	if (!volume.data.empty()) wf.write((const char *) &volume.data[0], sizeof(unsigned char) * volume.dim.num_elem());
 	
 	if(!wf.good()) 
 	{
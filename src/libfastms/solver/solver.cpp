@@ -30,6 +30,8 @@
 #include "util/types_equal.h"
 #include "util/has_cuda.h"
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 
 
 
@@ -40,6 +42,12 @@ public:
 
 	// general
 	virtual BaseImage* run(const BaseImage *in, const Par &par) = 0;
+	virtual void run_into(BaseImage *out, const BaseImage *in, const Par &par) = 0;
+	virtual std::vector<BaseImage*> run(const BaseImage *in, const std::vector<Par> &pars) = 0;
+	virtual std::vector<BaseImage*> run_sweep(const BaseImage *in, const std::vector<Par> &pars, std::vector<RunInfo> *run_infos) = 0;
+	virtual RunInfo get_run_info() = 0;
+	virtual size_t estimate_memory(const ArrayDim &dim, const Par &par) = 0;
+	virtual void reserve(const ArrayDim &dim, const Par &par) = 0;
 
 	// layered real
 	virtual void run(float *&out_image, const float *in_image, const ArrayDim &dim, const Par &par) = 0;
@@ -51,6 +59,7 @@ public:
 	// cv::Mat
 #ifndef DISABLE_OPENCV
 	virtual cv::Mat run(const cv::Mat in_image, const Par &par) = 0;
+	virtual void run_into(cv::Mat out_image, const cv::Mat in_image, const Par &par) = 0;
 #endif // not DISABLE_OPENCV
 
 	virtual int get_class_type() = 0; // for is_instance_of()
@@ -72,6 +81,30 @@ public:
 	{
 		return solver.run(in, par);
 	}
+	virtual void run_into(BaseImage *out, const BaseImage *in, const Par &par)
+	{
+		solver.run_into(out, in, par);
+	}
+	virtual std::vector<BaseImage*> run(const BaseImage *in, const std::vector<Par> &pars)
+	{
+		return solver.run(in, pars);
+	}
+	virtual std::vector<BaseImage*> run_sweep(const BaseImage *in, const std::vector<Par> &pars, std::vector<RunInfo> *run_infos)
+	{
+		return solver.run_sweep(in, pars, run_infos);
+	}
+	virtual RunInfo get_run_info()
+	{
+		return solver.get_run_info();
+	}
+	virtual size_t estimate_memory(const ArrayDim &dim, const Par &par)
+	{
+		return solver.estimate_memory(dim, par);
+	}
+	virtual void reserve(const ArrayDim &dim, const Par &par)
+	{
+		solver.reserve(dim, par);
+	}
 
 	// layered real
 	virtual void run(float *&out_image, const float *in_image, const ArrayDim &dim, const Par &par)
@@ -87,18 +120,16 @@ public:
 		typedef ManagedImage<real, DataInterpretationLayered> managed_image_t;
 
 		managed_image_t in_managed(const_cast<real*>(in_image), dim);
-		managed_image_t *out_managed = static_cast<managed_image_t*>(solver.run(&in_managed, par));
 		if (out_image)
 		{
-			// copy
-			managed_image_t outimage_managed(out_image, dim);
-			outimage_managed.copy_from_samekind(out_managed);
-		}
-		else
-		{
-			// move
-			out_image = out_managed->release_data();
+			// write directly into the given memory
+			managed_image_t outimage_managed(out_image, par.result_dim(dim));
+			solver.run_into(&outimage_managed, &in_managed, par);
+			return;
 		}
+		// move
+		managed_image_t *out_managed = static_cast<managed_image_t*>(solver.run(&in_managed, par));
+		out_image = out_managed->release_data();
 		delete out_managed;
 	}
 
@@ -108,18 +139,16 @@ public:
 		typedef ManagedImage<unsigned char, DataInterpretationInterlaced> managed_image_t;
 
 		managed_image_t in_managed(const_cast<unsigned char*>(in_image), dim);
-		managed_image_t *out_managed = static_cast<managed_image_t*>(solver.run(&in_managed, par));
 		if (out_image)
 		{
-			// copy
-			managed_image_t outimage_managed(out_image, dim);
-			outimage_managed.copy_from_samekind(out_managed);
-		}
-		else
-		{
-			// move
-			out_image = out_managed->release_data();
+			// write directly into the given memory
+			managed_image_t outimage_managed(out_image, par.result_dim(dim));
+			solver.run_into(&outimage_managed, &in_managed, par);
+			return;
 		}
+		// move
+		managed_image_t *out_managed = static_cast<managed_image_t*>(solver.run(&in_managed, par));
+		out_image = out_managed->release_data();
 		delete out_managed;
 	}
 
@@ -133,6 +162,12 @@ public:
 		delete out_matimage;
 		return out_mat;
 	}
+	void run_into(cv::Mat out_mat, const cv::Mat in_mat, const Par &par)
+	{
+		MatImage in_matimage(in_mat);
+		MatImage out_matimage(out_mat);
+		solver.run_into(&out_matimage, &in_matimage, par);
+	}
 #endif // not DISABLE_OPENCV
 
 	int get_class_type() { return class_type; }
@@ -176,6 +211,7 @@ template<typename real> void set_implementation_real(SolverImplementation *&impl
 	switch (par.engine)
 	{
 		case Par::engine_cpu:
+		case Par::engine_cpu_admm:
 		{
 			set_implementation_concrete<SolverImplementationConcrete<SolverHost<real> > >(implementation, par);
 			return;
@@ -221,6 +257,70 @@ void set_implementation(SolverImplementation *&implementation, const Par &par)
 
 
 
+Par Par::adapted_to(const ArrayDim &dim) const
+{
+	Par par = *this;
+	if (adapt_params)
+	{
+		double scale_omega = 1.0;
+		if (batch_1d == Par::batch_1d_rows) { scale_omega = double(dim.w) / 640.0; }
+		else if (batch_1d == Par::batch_1d_columns) { scale_omega = double(dim.h) / 640.0; }
+		else if (dim.h > 1) { scale_omega = std::sqrt(double(dim.w) * double(dim.h)) / std::sqrt(640.0 * 480.0); }
+		else { scale_omega = double(dim.w) / 640.0; }
+		if (alpha >= 0) { par.alpha = alpha * scale_omega * scale_omega; }
+		if (lambda >= 0) { par.lambda = lambda * scale_omega; }
+		par.adapt_params = false;
+	}
+	return par;
+}
+void Par::get_roi(const ArrayDim &dim, int *x0, int *y0, int *w, int *h) const
+{
+	if (!has_roi())
+	{
+		*x0 = 0; *y0 = 0; *w = (int)dim.w; *h = (int)dim.h;
+		return;
+	}
+	int x1 = std::min(roi_x + roi_w, (int)dim.w);
+	int y1 = std::min(roi_y + roi_h, (int)dim.h);
+	*x0 = std::max(0, std::min(roi_x, (int)dim.w));
+	*y0 = std::max(0, std::min(roi_y, (int)dim.h));
+	*w = std::max(0, x1 - *x0);
+	*h = std::max(0, y1 - *y0);
+}
+ArrayDim Par::result_dim(const ArrayDim &dim) const
+{
+	int x0, y0, w, h;
+	get_roi(dim, &x0, &y0, &w, &h);
+	return ArrayDim(w, h, dim.num_channels);
+}
+int Par::get_roi_halo(const ArrayDim &dim) const
+{
+	if (roi_halo >= 0) { return roi_halo; }
+	// the influence of a pixel reaches about sqrt(alpha) pixels for smoothing, and arbitrarily far for piecewise constant results
+	double alpha_adapted = adapted_to(dim).alpha;
+	if (alpha_adapted < 0) { return 128; }
+	return std::max(16, std::min(128, (int)std::ceil(8.0 * std::sqrt(alpha_adapted))));
+}
+void Par::get_roi_region(const ArrayDim &dim, int *x0, int *y0, ArrayDim *dim_region) const
+{
+	int roi_x0, roi_y0, w, h;
+	get_roi(dim, &roi_x0, &roi_y0, &w, &h);
+	int halo = get_roi_halo(dim);
+	*x0 = std::max(0, roi_x0 - halo);
+	*y0 = std::max(0, roi_y0 - halo);
+	int x1 = std::min((int)dim.w, roi_x0 + w + halo);
+	int y1 = std::min((int)dim.h, roi_y0 + h + halo);
+	*dim_region = ArrayDim(x1 - *x0, y1 - *y0, dim.num_channels);
+}
+bool Par::same_model_as(const Par &other) const
+{
+	return lambda == other.lambda && alpha == other.alpha && temporal == other.temporal && weight == other.weight &&
+		adapt_params == other.adapt_params && batch_1d == other.batch_1d && engine == other.engine && use_double == other.use_double &&
+		special_solvers == other.special_solvers && iterations == other.iterations && stop_eps == other.stop_eps && stop_k == other.stop_k;
+}
+
+
+
 Solver::Solver() : implementation(NULL) {}
 Solver::~Solver() { if (implementation) { delete implementation; } }
 BaseImage* Solver::run(const BaseImage *in, const Par &par)
@@ -228,6 +328,60 @@ BaseImage* Solver::run(const BaseImage *in, const Par &par)
 	set_implementation(implementation, par); if (!implementation) { return NULL; }
 	return implementation->run(in, par);
 }
+void Solver::run_into(BaseImage *out, const BaseImage *in, const Par &par)
+{
+	set_implementation(implementation, par); if (!implementation) { return; }
+	implementation->run_into(out, in, par);
+}
+std::vector<BaseImage*> Solver::run(const BaseImage *in, const std::vector<Par> &pars)
+{
+	if (pars.empty()) { return std::vector<BaseImage*>(); }
+	set_implementation(implementation, pars[0]); if (!implementation) { return std::vector<BaseImage*>(); }
+	return implementation->run(in, pars);
+}
+std::vector<BaseImage*> Solver::run_sweep(const BaseImage *in, const std::vector<Par> &pars, std::vector<RunInfo> *run_infos)
+{
+	if (pars.empty()) { if (run_infos) { run_infos->clear(); } return std::vector<BaseImage*>(); }
+	for (size_t k = 1; k < pars.size(); k++)
+	{
+		if (pars[k].engine != pars[0].engine || pars[k].use_double != pars[0].use_double)
+		{
+			// another engine or precision: each parameter set is solved on its own, with its implementation
+			std::vector<BaseImage*> results(pars.size(), (BaseImage*)NULL);
+			if (run_infos) { run_infos->assign(pars.size(), RunInfo()); }
+			for (size_t j = 0; j < pars.size(); j++)
+			{
+				set_implementation(implementation, pars[j]); if (!implementation) { continue; }
+				std::vector<RunInfo> run_info_j;
+				std::vector<BaseImage*> result_j = implementation->run_sweep(in, std::vector<Par>(1, pars[j]), (run_infos? &run_info_j : NULL));
+				results[j] = result_j[0];
+				if (run_infos) { (*run_infos)[j] = run_info_j[0]; }
+			}
+			return results;
+		}
+	}
+	set_implementation(implementation, pars[0]); if (!implementation) { return std::vector<BaseImage*>(); }
+	return implementation->run_sweep(in, pars, run_infos);
+}
+RunInfo Solver::get_run_info()
+{
+	if (!implementation) { return RunInfo(); }
+	return implementation->get_run_info();
+}
+size_t Solver::estimate_memory(const ArrayDim &dim, const Par &par)
+{
+	// separate implementation, so that the current one (and its arrays) is kept even if par selects another precision or engine
+	SolverImplementation *estimator = NULL;
+	set_implementation(estimator, par); if (!estimator) { return 0; }
+	size_t mem = estimator->estimate_memory(dim, par);
+	delete estimator;
+	return mem;
+}
+void Solver::reserve(const ArrayDim &dim, const Par &par)
+{
+	set_implementation(implementation, par); if (!implementation) { return; }
+	implementation->reserve(dim, par);
+}
 void Solver::run(float *&out_image, const float *in_image, const ArrayDim &dim, const Par &par)
 {
 	set_implementation_real<float>(implementation, par); if (!implementation) { return; }
@@ -249,6 +403,11 @@ cv::Mat Solver::run(const cv::Mat in_image, const Par &par)
 	set_implementation(implementation, par); if (!implementation) { return cv::Mat(); }
 	return implementation->run(in_image, par);
 }
+void Solver::run_into(cv::Mat out_image, const cv::Mat in_image, const Par &par)
+{
+	set_implementation(implementation, par); if (!implementation) { return; }
+	implementation->run_into(out_image, in_image, par);
+}
 #endif // not DISABLE_OPENCV
 
 
@@ -25,9 +25,13 @@
 #endif // not DISABLE_OPENCV
 
 #include <iostream>
+#include <vector>
+#include "solver_progress.h"
 
 
 
+class ArrayDim;
+
 struct Par
 {
 	Par()
@@ -35,6 +39,13 @@ struct Par
 		lambda = 0.1;
 		alpha = 20.0;
 		temporal = 0.0;
+		incremental = false;
+		incremental_eps = 0.02;
+		incremental_max_fraction = 0.5;
+		time_budget = 0.0;
+		progress_callback = NULL;
+		progress_user_data = NULL;
+		progress_k = 10;
 		iterations = 10000;
 		stop_eps = 5e-5;
 		stop_k = 10;
@@ -43,23 +54,71 @@ struct Par
 		edges = false;
 		use_double = false;
 		engine = engine_cuda;
+		special_solvers = false;
+		batch_1d = batch_1d_none;
+		tile_max_memory = 1024.0;
+		tile_size = 0;
+		tile_overlap = 32;
+		roi_x = 0;
+		roi_y = 0;
+		roi_w = 0;
+		roi_h = 0;
+		roi_halo = -1;
+		downscale = 1;
+		chroma_downscale = 1;
+		downscale_sigma_range = 0.1;
 		verbose = true;
 	}
 
+	// Copy of the parameters with lambda and alpha set as adapt_params would set them for an image of size dim, and adapt_params = false.
+	// Used to solve parts of an image with the parameters of the whole image.
+	Par adapted_to(const ArrayDim &dim) const;
+
+	bool has_roi() const { return roi_w > 0 && roi_h > 0; }
+
+	// Region of interest clipped to an image of size dim, i.e. the size of the result, or the whole image if there is no region
+	void get_roi(const ArrayDim &dim, int *x0, int *y0, int *w, int *h) const;
+
+	// Halo of the region of interest in pixels: roi_halo, or if it is < 0 chosen from alpha (for an image of size dim)
+	int get_roi_halo(const ArrayDim &dim) const;
+
+	// The part of an image of size dim which is solved for the region of interest: the region plus the halo, clipped to the image
+	void get_roi_region(const ArrayDim &dim, int *x0, int *y0, ArrayDim *dim_region) const;
+
+	// Size of the result for an image of size dim: the clipped region of interest, or dim
+	ArrayDim result_dim(const ArrayDim &dim) const;
+
+	// Whether the solution for other has the same model and the same solver as for this, i.e. a previous solution can be reused
+	bool same_model_as(const Par &other) const;
+
 	void print() const
 	{
 	    std::cout << "Params:\n";
 	    std::cout << "  lambda: " << lambda << "\n";
 	    std::cout << "  alpha: " << alpha << "\n";
 	    std::cout << "  temporal: " << temporal << "\n";
+	    std::cout << "  incremental: " << incremental << "\n";
+	    std::cout << "  incremental_eps: " << incremental_eps << "\n";
+	    std::cout << "  incremental_max_fraction: " << incremental_max_fraction << "\n";
 	    std::cout << "  iterations: " << iterations << "\n";
 	    std::cout << "  stop_eps: " << stop_eps << "\n";
 	    std::cout << "  stop_k: " << stop_k << "\n";
+	    std::cout << "  time_budget: " << time_budget << "\n";
+	    std::cout << "  progress_k: " << progress_k << "\n";
 	    std::cout << "  adapt_params: " << adapt_params << "\n";
 	    std::cout << "  weight: " << weight << "\n";
 	    std::cout << "  edges: " << edges << "\n";
 	    std::cout << "  use_double: " << use_double << "\n";
-	    std::cout << "  engine: " << (engine == Par::engine_cpu? "cpu" : "cuda") << "\n";
+	    std::cout << "  engine: " << (engine == Par::engine_cpu? "cpu" : engine == Par::engine_cpu_admm? "cpu_admm" : "cuda") << "\n";
+	    std::cout << "  special_solvers: " << special_solvers << "\n";
+	    std::cout << "  batch_1d: " << (batch_1d == Par::batch_1d_rows? "rows" : batch_1d == Par::batch_1d_columns? "columns" : "none") << "\n";
+	    std::cout << "  tile_max_memory: " << tile_max_memory << "\n";
+	    std::cout << "  tile_size: " << tile_size << "\n";
+	    std::cout << "  tile_overlap: " << tile_overlap << "\n";
+	    std::cout << "  roi: " << roi_x << ", " << roi_y << ", " << roi_w << " x " << roi_h << ", halo " << roi_halo << "\n";
+	    std::cout << "  downscale: " << downscale << "\n";
+	    std::cout << "  chroma_downscale: " << chroma_downscale << "\n";
+	    std::cout << "  downscale_sigma_range: " << downscale_sigma_range << "\n";
 	}
 
 	// Length penalization parameter.
@@ -89,6 +148,19 @@ struct Par
     //   Value temporal_regularization = 0: No temporal regularization, each frame is independent.
     double temporal;
 
+    // Incremental mode for video with a fixed camera (CPU engine only).
+    //   If true: Only the 32 x 32 tiles in which the input has changed since the previous frame, plus a halo of one tile around them, are recomputed.
+    //   The solution and the dual variables of all other tiles are kept from the previous frame.
+    //   Has an effect only if the model and the solver are the same as for the previous frame (see same_model_as()), and the frame size is the same.
+    bool incremental;
+
+    // Only with incremental: A tile counts as changed if any input value differs by more than incremental_eps from the previous frame.
+    //   Should be above the noise level of the camera.
+    double incremental_eps;
+
+    // Only with incremental: If the fraction of changed tiles is larger than this, the whole frame is recomputed.
+    double incremental_max_fraction;
+
     // Maximal number of iterations to perform.
     // This is only an upper bound for the maximal number of iterations. The actual number of iterations may be less than this, since the iterations will be stopped once difference between consecutive solutions is small enough.
     int iterations;
@@ -101,6 +173,21 @@ struct Par
     // If set to <= 0, no checking will be performed, i.e. all max_num_iterations iterations will be made.
     int stop_k;
 
+    // Time budget in seconds for one call of Solver::run, including initialization and copying of the result.
+    // The iterations are stopped once the next iteration would not fit into the budget anymore, and the current solution is returned.
+    // The elapsed time is checked only a few times, at iterations planned from the measured time per iteration.
+    // Use Solver::get_run_info() to find out whether the time budget was exceeded, and how many iterations were done.
+    // Value <= 0: No time budget.
+    double time_budget;
+
+    // Progress callback, called every progress_k iterations with the number of iterations, the current value of the stopping criterion
+    // and a read-only view of the current solution, see ProgressInfo. If it returns false, the iterations are stopped and the current solution is returned.
+    // progress_user_data is passed to the callback as is.
+    // Value NULL: No callback.
+    ProgressCallback progress_callback;
+    void *progress_user_data;
+    int progress_k;
+
     // If true: lambda and alpha will be adapted so that the solution will look more or less the same, for one and the same input image and for different scalings.
     //   Using this, one can run time intensive experiments on downscaled images, find suitable parameters, and then run the experiment on the original images, with the same parameters.
     //   Effectively, lambda and alpha are used as is for a "standard" image scale (640 x 480), and for a general image size w * h
@@ -132,9 +219,76 @@ struct Par
     bool use_double;
 
     // Use CPU or CUDA.
+    // engine_cpu_admm: Minimize the anisotropic variant of the model, with separate penalties
+    //   min(alpha * |u_x|^2, lambda * weight) + min(alpha * |u_y|^2, lambda * weight)  for the x and y differences,
+    //   by ADMM splitting into 1d problems along all rows and all columns, each solved exactly on the CPU.
+    //   Needs far fewer (outer) iterations than the primal-dual algorithm. Falls back to engine_cpu with temporal regularization.
 	int engine;
 	static const int engine_cpu = 0;
 	static const int engine_cuda = 1;
+	static const int engine_cpu_admm = 2;
+
+	// If true: Special cases of the model are computed by dedicated solvers instead of the primal-dual iterations:
+	//   - 1d signals (h == 1 or w == 1, without temporal regularization): exact global minimizer by dynamic programming on the CPU.
+	//   - alpha < 0 (piecewise constant case, without temporal regularization): greedy region fusion on the CPU.
+	//     This is much faster than the primal-dual iterations, but only a heuristic for a related anisotropic energy
+	//     (jumps counted per neighbor pair), so its result and energy may differ from the primal-dual solution.
+	// If false: Always use the primal-dual iterations.
+	bool special_solvers;
+
+	// Batched 1d mode: Each row (or each column) of the input is an independent 1d Mumford-Shah problem.
+	// All rows are solved exactly by dynamic programming, in parallel on the CPU, using the memory of one single solve.
+	// With adapt_params, lambda and alpha are adapted to the row length (w for rows, h for columns) as for a 1d image.
+	// The reported energy is the sum of the 1d energies. Temporal regularization is ignored in this mode.
+	int batch_1d;
+	static const int batch_1d_none = 0;
+	static const int batch_1d_rows = 1;
+	static const int batch_1d_columns = 2;
+
+	// Only for TiledSolver (solver/solver_tiled.h), which solves images larger than the memory tile by tile:
+	// Memory cap in MB for all tiles computed in parallel, including their solver arrays.
+	// The tile size is chosen as large as possible under this cap, if tile_size <= 0.
+	// Value <= 0 (and tile_size <= 0): No cap, the whole image is one tile.
+	double tile_max_memory;
+
+	// Only for TiledSolver: Tile size in pixels, without the overlap. Value <= 0: Chosen from tile_max_memory.
+	// For StreamingSolver (solver/solver_streaming.h): Number of rows of a window, without the overlap. Value <= 0: 64 rows.
+	int tile_size;
+
+	// Only for TiledSolver and StreamingSolver: Each tile (window) is computed with tile_overlap additional pixels on each side.
+	// Of these, the outer half is discarded and the inner half is blended linearly with the neighboring tiles, to avoid seams.
+	int tile_overlap;
+
+	// Region of interest: Only the rectangle of size roi_w x roi_h at (roi_x, roi_y) of the input is computed, and the result has this size.
+	// The solver converts and allocates only the region plus a halo of roi_halo pixels around it (clipped to the image),
+	// so that the result inside the region matches the result for the whole image up to a small difference.
+	// lambda and alpha are adapted (with adapt_params) to the whole image, and the arrays are reused for successive regions of the same size.
+	// Used by Solver::run() and run_into(), not by the versions with several parameter sets.
+	// Value roi_w <= 0 or roi_h <= 0: No region, the whole image is computed.
+	// Value roi_halo < 0: Chosen automatically from alpha, 8 * sqrt(alpha) pixels between 16 and 128, and 128 for alpha < 0.
+	int roi_x;
+	int roi_y;
+	int roi_w;
+	int roi_h;
+	int roi_halo;
+
+	// Fast approximate mode: Solve at 1 / downscale of the resolution (f box filtered), with lambda and alpha scaled to give the same energy,
+	// and upsample the solution to full resolution by joint bilateral upsampling guided by the full resolution f (solver/solver_upsample.h).
+	// The discontinuities of the low resolution solution are kept. Edges (edges = true) are drawn at full resolution.
+	// Used by Solver::run() and run_into(), not by the versions with several parameter sets.
+	// Value <= 1: Solve at full resolution.
+	int downscale;
+
+	// Color images (3 channels, RGB): Solve luma at full resolution and chroma (Cb, Cr) at 1 / chroma_downscale of the resolution, e.g. 2 or 4,
+	// and recombine to RGB. The chroma solve takes its discontinuities from the luma solution, through the regularizer weight (as with weight = true).
+	// This roughly halves the work and the memory of the dual variables. Chroma is upsampled as with downscale.
+	// Used by Solver::run() and run_into(), not by the versions with several parameter sets.
+	// Ignored if downscale > 1: The downscaled solve treats all channels together.
+	// Value <= 1: All channels are solved together at full resolution.
+	int chroma_downscale;
+
+	// Only for downscale > 1 or chroma_downscale > 1: Range scale of the upsampling, as difference between f and the solution (per channel, images in [0, 1]).
+	double downscale_sigma_range;
 
 	// If true: Output information:
 	//   - image dimensions
@@ -146,6 +300,46 @@ struct Par
 };
 
 
+// Information about one computed solution
+struct RunInfo
+{
+	RunInfo()
+	{
+		iterations = 0;
+		energy = 0.0;
+		converged = false;
+		time_budget_exceeded = false;
+		cancelled = false;
+		change = 0.0;
+		time_compute = 0.0;
+		time = 0.0;
+	}
+
+	// Number of performed iterations.
+	int iterations;
+
+	// Energy of the solution.
+	double energy;
+
+	// Whether the stopping criterion was reached within the maximal number of iterations and the time budget.
+	bool converged;
+
+	// Whether the iterations were stopped because of the time budget, see Par::time_budget.
+	bool time_budget_exceeded;
+
+	// Whether the iterations were stopped by the progress callback, see Par::progress_callback.
+	bool cancelled;
+
+	// Last computed value of the stopping criterion (see Par::stop_eps), or 0 if it was not checked.
+	// With engine_cpu_admm, this is the mean difference of the two split variables, the result is only reliable if it is small.
+	double change;
+
+	// Time for computation only, and overall time including initialization and copying, in seconds.
+	double time_compute;
+	double time;
+};
+
+
 // p_impl design pattern to reduce header to the minimum in order to avoid unnecessary dependencies
 class SolverImplementation;
 
@@ -163,7 +357,42 @@ public:
 	// general
 	BaseImage* run(const BaseImage *in, const Par &par);
 
+	// Writes the result directly into out, which must have the size of in (the elem type and layout may differ).
+	// Together with reserve() and an input that can be used without a copy, a run allocates no memory.
+	// out may share its memory with in.
+	void run_into(BaseImage *out, const BaseImage *in, const Par &par);
+
+	// Several parameter sets for the same input, one result per parameter set.
+	// If the parameter sets differ only in lambda, alpha and edges, they are solved together in one pass on the CPU,
+	// sharing the input, the weight and the step sizes. Otherwise, and on CUDA, they are solved one after the other.
+	std::vector<BaseImage*> run(const BaseImage *in, const std::vector<Par> &pars);
+
+	// Regularization path: Solutions for several parameter sets for the same input, one result per parameter set.
+	// The parameter sets are solved in the order of increasing lambda (then alpha), each one warm started
+	// from the solution of the previous one, which needs only a fraction of the iterations of a cold start.
+	// If run_infos is not NULL, it receives the number of iterations, the energy etc. for each parameter set.
+	// The parameter sets must agree in weight, adapt_params, engine and use_double, and have no temporal regularization, otherwise each one is solved from scratch.
+	// The same holds if any of them is solved by another solver: engine_cpu_admm, batch_1d, incremental, a region of interest, downscale or chroma_downscale,
+	// or with special_solvers alpha < 0 or a 1d image.
+	std::vector<BaseImage*> run_sweep(const BaseImage *in, const std::vector<Par> &pars, std::vector<RunInfo> *run_infos = NULL);
+
+	// Information about the last computed solution: iterations, energy, whether the time budget was exceeded etc.
+	RunInfo get_run_info();
+
+	// Memory in bytes which run() will allocate for an image of size dim with the parameters par:
+	// all solver arrays, the host copies and working arrays of the special solvers, and on CUDA the temporary device copy for the image conversion.
+	// With a region of interest, downscale or chroma_downscale, the solver arrays are those of the smaller solves, plus their host arrays.
+	// This is an upper bound, e.g. the special solvers are counted whenever they may be used. The result image itself is not included.
+	size_t estimate_memory(const ArrayDim &dim, const Par &par);
+
+	// Allocates the memory for an image of size dim with the parameters par in advance, so that the next run() does not need to allocate.
+	void reserve(const ArrayDim &dim, const Par &par);
+
+	// Raw pointer versions: if out_image is not NULL, the result is written directly into it, otherwise out_image receives newly allocated memory.
+
 	// layered real
+	// If the elem type is that of the computation (float, or double with use_double), in_image is used directly without a copy.
+	// The same holds for any BaseImage which provides get_layered_view(), e.g. a StridedImage (util/image.h) with a row pitch.
 	void run(float *&out_image, const float *in_image, const ArrayDim &dim, const Par &par);
 	void run(double *&out_image, const double *in_image, const ArrayDim &dim, const Par &par);
 
@@ -173,6 +402,7 @@ public:
 	// cv::Mat
 #ifndef DISABLE_OPENCV
 	cv::Mat run(const cv::Mat in_image, const Par &par);
+	void run_into(cv::Mat out_image, const cv::Mat in_image, const Par &par);  // out_image must be allocated with the size and number of channels of in_image
 #endif // not DISABLE_OPENCV
 
 
@@ -0,0 +1,229 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SOLVER_1D_H
+#define SOLVER_1D_H
+
+#include "util/real.h"
+#include <vector>
+
+
+
+// Exact minimization of the 1d Mumford-Shah model
+//
+//   sum_x |u(x) - f(x)|^2 + sum_{x < n-1} min(alpha * |u(x+1) - u(x)|^2, lambda * weight(x))
+//
+// by dynamic programming over the jump positions (a jump between x and x+1 costs lambda * weight(x)):
+//   best(r) = min_l  best(l-1) + lambda * weight(l-1) + cost of the smooth segment [l, r].
+// For every candidate start l of the last segment, the segment cost as a function of u(r) is kept in closed form
+// and updated in O(1) per channel when r advances. A candidate is dropped for good as soon as it cannot beat
+// starting a new segment after r anymore (the segment cost is superadditive), see Killick, Fearnhead, Eckley:
+// "Optimal Detection of Changepoints With a Linear Computational Cost", 2012. This gives O(n * k) run time,
+// with k the typical segment length.
+//
+// alpha < 0 means alpha = infinity (piecewise constant segments), lambda < 0 means lambda = infinity (no jumps).
+// Host only. All computations are done in double, independently of the type of the data.
+template<typename real>
+class ExactSolver1D
+{
+public:
+	// u, f: n * num_channels values, the value of channel i at x is at [x + n * i].
+	// weight: n values, or NULL for weight = 1 everywhere.
+	// Returns the minimal energy.
+	real run(real *u, const real *f, const real *weight, int n, int num_channels, real alpha, real lambda)
+	{
+		if (n <= 0) { return real(0); }
+		const bool lambda_infinite = !(lambda >= real(0) && lambda < realmax<real>());
+		this->alpha_infinite = !(alpha >= real(0) && alpha < realmax<real>());
+		this->alpha = (double)alpha;
+		this->num_channels = num_channels;
+		best.resize(n);
+		best_left.resize(n);
+		init_length_coeffs(n);
+		cand_left.resize(n);
+		cand_base.resize(n);
+		cand_e.resize(n);
+		cand_t.resize(n);
+		cand_s.resize(n);
+		cand_m.resize((size_t)n * num_channels);
+		int num_cand = 0;
+
+		for (int r = 0; r < n; r++)
+		{
+			// new candidate: a jump between r-1 and r
+			if (r == 0 || !lambda_infinite)
+			{
+				cand_left[num_cand] = r;
+				cand_base[num_cand] = (r > 0? best[r - 1] + (double)lambda * (weight? (double)weight[r - 1] : 1.0) : 0.0);
+				cand_e[num_cand] = 0.0;
+				for (int i = 0; i < num_channels; i++) { cand_m[num_cand + (size_t)n * i] = 0.0; }
+				num_cand++;
+			}
+
+			// add the data term at r to all candidates, channel by channel so that the loops over the candidates vectorize
+			for (int k = 0; k < num_cand; k++)
+			{
+				const int len = r - cand_left[k];
+				cand_t[k] = len_t[len];
+				cand_s[k] = len_s[len];
+			}
+			for (int i = 0; i < num_channels; i++)
+			{
+				const double f0 = (double)f[r + (size_t)n * i];
+				double *m_i = &cand_m[(size_t)n * i];
+				for (int k = 0; k < num_cand; k++)
+				{
+					double diff = m_i[k] - f0;
+					cand_e[k] += cand_t[k] * diff * diff;
+					m_i[k] -= cand_s[k] * diff;
+				}
+			}
+
+			double best_r = realmax<double>();
+			int best_left_r = 0;
+			for (int k = 0; k < num_cand; k++)
+			{
+				double cost = cand_base[k] + cand_e[k];
+				if (cost < best_r)
+				{
+					best_r = cost;
+					best_left_r = cand_left[k];
+				}
+			}
+			best[r] = best_r;
+			best_left[r] = best_left_r;
+
+			// drop the candidates which are worse than a jump between r and r+1 for every later r
+			if (!lambda_infinite && r + 1 < n)
+			{
+				double bound = best_r + (double)lambda * (weight? (double)weight[r] : 1.0);
+				int num_kept = 0;
+				for (int k = 0; k < num_cand; k++)
+				{
+					if (cand_base[k] + cand_e[k] > bound) { continue; }
+					if (num_kept < k)
+					{
+						cand_left[num_kept] = cand_left[k];
+						cand_base[num_kept] = cand_base[k];
+						cand_e[num_kept] = cand_e[k];
+						for (int i = 0; i < num_channels; i++) { cand_m[num_kept + (size_t)n * i] = cand_m[k + (size_t)n * i]; }
+					}
+					num_kept++;
+				}
+				num_cand = num_kept;
+			}
+		}
+
+		// reconstruct the solution from the segments
+		for (int r = n - 1; r >= 0; r = best_left[r] - 1)
+		{
+			solve_segment(u, f, n, best_left[r], r);
+		}
+		return (real)best[n - 1];
+	}
+
+private:
+	// The cost of the segment [l, r] of candidate k as a function of u(r) is kept in the form
+	//   sum_i a(r - l + 1) * (u_i(r) - m_i)^2 + cand_e[k],  with m_i = cand_m[k + n * i].
+	// Adding the data term (u(r) - f(r))^2 to a segment of length len changes these to
+	//   cand_e[k] += len_t[len] * |m - f(r)|^2,  m -= len_s[len] * (m - f(r)).
+	// The curvature a only depends on the segment length: a(0) = 0, a(len + 1) = alpha * a(len) / (alpha + a(len)) + 1,
+	// so the coefficients are precomputed per length.
+	void init_length_coeffs(int n)
+	{
+		len_t.resize(n);
+		len_s.resize(n);
+		double a = 0.0;
+		for (int len = 0; len < n; len++)
+		{
+			// minimize over u(r-1) with the coupling alpha * (u(r) - u(r-1))^2
+			if (!alpha_infinite) { a = (alpha + a > 0.0? alpha * a / (alpha + a) : 0.0); }
+			len_t[len] = a / (a + 1.0);
+			len_s[len] = 1.0 / (a + 1.0);
+			a += 1.0;
+		}
+	}
+
+	// minimize sum_x (u(x) - f(x))^2 + alpha * sum_x (u(x+1) - u(x))^2 on [l, r], a tridiagonal linear system
+	void solve_segment(real *u, const real *f, int n, int l, int r)
+	{
+		const int len = r - l + 1;
+		for (int i = 0; i < num_channels; i++)
+		{
+			const real *f_i = f + (size_t)n * i + l;
+			real *u_i = u + (size_t)n * i + l;
+			if (alpha_infinite || len == 1)
+			{
+				double mean = 0.0;
+				for (int k = 0; k < len; k++) { mean += (double)f_i[k]; }
+				mean /= len;
+				for (int k = 0; k < len; k++) { u_i[k] = (real)mean; }
+				continue;
+			}
+
+			// Thomas algorithm, with diagonal 1 + alpha * (number of neighbors) and off-diagonals -alpha
+			tridiag_c.resize(len);
+			tridiag_d.resize(len);
+			double c_prev = 0.0;
+			double d_prev = 0.0;
+			for (int k = 0; k < len; k++)
+			{
+				double diag = 1.0 + alpha * ((k > 0? 1.0 : 0.0) + (k + 1 < len? 1.0 : 0.0));
+				double denom = diag + alpha * c_prev;
+				double c = (k + 1 < len? -alpha / denom : 0.0);
+				double d = ((double)f_i[k] + alpha * d_prev) / denom;
+				tridiag_c[k] = c;
+				tridiag_d[k] = d;
+				c_prev = c;
+				d_prev = d;
+			}
+			double val = tridiag_d[len - 1];
+			u_i[len - 1] = (real)val;
+			for (int k = len - 2; k >= 0; k--)
+			{
+				val = tridiag_d[k] - tridiag_c[k] * val;
+				u_i[k] = (real)val;
+			}
+		}
+	}
+
+	double alpha;
+	bool alpha_infinite;
+	int num_channels;
+	std::vector<double> best;
+	std::vector<int> best_left;
+
+	// active candidates for the start of the last segment
+	std::vector<int> cand_left;
+	std::vector<double> cand_base;
+	std::vector<double> cand_e;
+	std::vector<double> cand_t;
+	std::vector<double> cand_s;
+	std::vector<double> cand_m;
+
+	// update coefficients per segment length
+	std::vector<double> len_t;
+	std::vector<double> len_s;
+	std::vector<double> tridiag_c;
+	std::vector<double> tridiag_d;
+};
+
+
+
+#endif // SOLVER_1D_H
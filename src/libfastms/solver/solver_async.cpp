@@ -0,0 +1,340 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "solver_async.h"
+
+#include "util/image.h"
+#include <pthread.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>  // for std::max
+
+
+
+struct AsyncJobState
+{
+	AsyncJobState(const BaseImage *in, const Par &par, int priority, long long seq) :
+		in(in), par(par), dim(in->dim()), priority(priority), seq(seq), result(NULL), done(false), ref_count(1)
+	{
+		pthread_mutex_init(&mutex, NULL);
+		pthread_cond_init(&cond_done, NULL);
+	}
+	~AsyncJobState()
+	{
+		if (result) { delete result; }
+		pthread_cond_destroy(&cond_done);
+		pthread_mutex_destroy(&mutex);
+	}
+	void add_ref()
+	{
+		pthread_mutex_lock(&mutex);
+		ref_count++;
+		pthread_mutex_unlock(&mutex);
+	}
+	static void release(AsyncJobState *state)
+	{
+		if (!state) { return; }
+		pthread_mutex_lock(&state->mutex);
+		bool is_last = (--state->ref_count == 0);
+		pthread_mutex_unlock(&state->mutex);
+		if (is_last) { delete state; }
+	}
+	void wait()
+	{
+		pthread_mutex_lock(&mutex);
+		while (!done) { pthread_cond_wait(&cond_done, &mutex); }
+		pthread_mutex_unlock(&mutex);
+	}
+	void finish(BaseImage *job_result, const RunInfo &job_run_info)
+	{
+		pthread_mutex_lock(&mutex);
+		result = job_result;
+		run_info = job_run_info;
+		done = true;
+		pthread_cond_broadcast(&cond_done);
+		pthread_mutex_unlock(&mutex);
+	}
+
+	// job
+	const BaseImage *in;
+	Par par;
+	ArrayDim dim;
+	int priority;
+	long long seq;
+
+	// result
+	BaseImage *result;
+	RunInfo run_info;
+	bool done;
+
+	int ref_count;  // handles, plus one for the solver until the job is done
+	pthread_mutex_t mutex;
+	pthread_cond_t cond_done;
+};
+
+
+
+AsyncJob::AsyncJob() : state(NULL) {}
+AsyncJob::AsyncJob(AsyncJobState *state) : state(state) {}
+AsyncJob::AsyncJob(const AsyncJob &other_job) : state(other_job.state) { if (state) { state->add_ref(); } }
+AsyncJob& AsyncJob::operator= (const AsyncJob &other_job)
+{
+	if (other_job.state) { other_job.state->add_ref(); }
+	AsyncJobState::release(state);
+	state = other_job.state;
+	return *this;
+}
+AsyncJob::~AsyncJob() { AsyncJobState::release(state); }
+bool AsyncJob::is_valid() const { return state != NULL; }
+bool AsyncJob::is_done() const
+{
+	if (!state) { return false; }
+	pthread_mutex_lock(&state->mutex);
+	bool done = state->done;
+	pthread_mutex_unlock(&state->mutex);
+	return done;
+}
+void AsyncJob::wait() const
+{
+	if (state) { state->wait(); }
+}
+BaseImage* AsyncJob::get_result()
+{
+	if (!state) { return NULL; }
+	state->wait();
+	pthread_mutex_lock(&state->mutex);
+	BaseImage *result = state->result;
+	state->result = NULL;
+	pthread_mutex_unlock(&state->mutex);
+	return result;
+}
+RunInfo AsyncJob::get_run_info() const
+{
+	if (!state) { return RunInfo(); }
+	state->wait();
+	return state->run_info;  // not changed anymore once done
+}
+
+
+
+class AsyncSolverImplementation
+{
+public:
+	AsyncSolverImplementation(int num_workers, int max_queue) : max_queue(std::max(1, max_queue)), stopping(false), next_seq(0), num_busy(0)
+	{
+		pthread_mutex_init(&mutex, NULL);
+		pthread_cond_init(&cond_queue, NULL);
+		pthread_cond_init(&cond_space, NULL);
+		pthread_cond_init(&cond_idle, NULL);
+		num_workers = std::max(1, num_workers);
+		pthread_mutex_lock(&mutex);  // the workers look at each other in pick_job()
+		for (int i = 0; i < num_workers; i++)
+		{
+			Worker *worker = new Worker(this);
+			if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) { delete worker; break; }
+			workers.push_back(worker);
+		}
+		pthread_mutex_unlock(&mutex);
+		if (workers.empty()) { std::cerr << "ERROR: AsyncSolver: Could not create worker threads" << std::endl; }
+	}
+	~AsyncSolverImplementation()
+	{
+		pthread_mutex_lock(&mutex);
+		stopping = true;
+		pthread_cond_broadcast(&cond_queue);
+		pthread_cond_broadcast(&cond_space);
+		pthread_mutex_unlock(&mutex);
+		for (int i = 0; i < (int)workers.size(); i++)
+		{
+			pthread_join(workers[i]->thread, NULL);
+			delete workers[i];
+		}
+		// only without any worker threads: jobs which could not be computed
+		for (int i = 0; i < (int)queue.size(); i++)
+		{
+			queue[i]->finish(NULL, RunInfo());
+			AsyncJobState::release(queue[i]);
+		}
+		pthread_cond_destroy(&cond_idle);
+		pthread_cond_destroy(&cond_space);
+		pthread_cond_destroy(&cond_queue);
+		pthread_mutex_destroy(&mutex);
+	}
+
+	AsyncJob submit(const BaseImage *in, const Par &par, int priority, bool blocking)
+	{
+		if (!in || workers.empty()) { return AsyncJob(); }
+		pthread_mutex_lock(&mutex);
+		while ((int)queue.size() >= max_queue && !stopping)
+		{
+			if (!blocking) { pthread_mutex_unlock(&mutex); return AsyncJob(); }
+			pthread_cond_wait(&cond_space, &mutex);
+		}
+		if (stopping) { pthread_mutex_unlock(&mutex); return AsyncJob(); }
+		AsyncJobState *state = new AsyncJobState(in, par, priority, next_seq++);
+		state->add_ref();  // for the handle
+		queue.push_back(state);
+		pthread_cond_broadcast(&cond_queue);  // which worker takes the job depends on the workers' previous jobs
+		pthread_mutex_unlock(&mutex);
+		return AsyncJob(state);
+	}
+	void wait_all()
+	{
+		pthread_mutex_lock(&mutex);
+		while (!queue.empty() || num_busy > 0) { pthread_cond_wait(&cond_idle, &mutex); }
+		pthread_mutex_unlock(&mutex);
+	}
+	int num_queued()
+	{
+		pthread_mutex_lock(&mutex);
+		int num = (int)queue.size();
+		pthread_mutex_unlock(&mutex);
+		return num;
+	}
+	int num_workers() { return (int)workers.size(); }
+
+private:
+	struct Worker
+	{
+		Worker(AsyncSolverImplementation *owner) : owner(owner), idle(true), has_prev_job(false), prev_use_double(false), prev_engine(0) {}
+		bool matches(const AsyncJobState *job) const
+		{
+			return has_prev_job && prev_dim.w == job->dim.w && prev_dim.h == job->dim.h && prev_dim.num_channels == job->dim.num_channels &&
+				prev_use_double == job->par.use_double && prev_engine == job->par.engine;
+		}
+
+		AsyncSolverImplementation *owner;
+		pthread_t thread;
+		Solver solver;
+		bool idle;
+
+		// previous job, determines the current memory allocation of the solver
+		bool has_prev_job;
+		ArrayDim prev_dim;
+		bool prev_use_double;
+		int prev_engine;
+	};
+
+	static void* worker_main(void *arg)
+	{
+		Worker *worker = (Worker*)arg;
+		worker->owner->run_worker(worker);
+		return NULL;
+	}
+
+	// Called with the mutex locked. Returns the index of the job to run next by the worker, or -1 if there is none.
+	// Order: Higher priority first, then jobs matching the worker's previous job, then in the order of submission.
+	// A job which does not match the worker is left to another idle worker which matches it, if any.
+	int pick_job(const Worker *worker)
+	{
+		int best = -1;
+		bool best_matches = false;
+		for (int i = 0; i < (int)queue.size(); i++)
+		{
+			const AsyncJobState *job = queue[i];
+			bool job_matches = worker->matches(job);
+			if (!job_matches)
+			{
+				bool other_matches = false;
+				for (int j = 0; j < (int)workers.size() && !other_matches; j++)
+				{
+					other_matches = (workers[j] != worker && workers[j]->idle && workers[j]->matches(job));
+				}
+				if (other_matches) { continue; }
+			}
+			if (best >= 0)
+			{
+				const AsyncJobState *best_job = queue[best];
+				if (job->priority != best_job->priority) { if (job->priority < best_job->priority) { continue; } }
+				else if (job_matches != best_matches) { if (!job_matches) { continue; } }
+				else if (job->seq > best_job->seq) { continue; }
+			}
+			best = i;
+			best_matches = job_matches;
+		}
+		return best;
+	}
+
+	void run_worker(Worker *worker)
+	{
+		for (;;)
+		{
+			pthread_mutex_lock(&mutex);
+			int i;
+			while ((i = pick_job(worker)) < 0)
+			{
+				if (stopping && queue.empty()) { pthread_mutex_unlock(&mutex); return; }
+				pthread_cond_wait(&cond_queue, &mutex);
+			}
+			AsyncJobState *job = queue[i];
+			queue.erase(queue.begin() + i);
+			worker->idle = false;
+			num_busy++;
+			pthread_cond_signal(&cond_space);
+			if (!queue.empty()) { pthread_cond_broadcast(&cond_queue); }  // jobs left for this worker may be taken by others now
+			pthread_mutex_unlock(&mutex);
+
+			BaseImage *result = worker->solver.run(job->in, job->par);
+			RunInfo run_info = worker->solver.get_run_info();
+			job->finish(result, run_info);
+
+			pthread_mutex_lock(&mutex);
+			worker->has_prev_job = true;
+			worker->prev_dim = job->dim;
+			worker->prev_use_double = job->par.use_double;
+			worker->prev_engine = job->par.engine;
+			worker->idle = true;
+			num_busy--;
+			if (queue.empty() && num_busy == 0) { pthread_cond_broadcast(&cond_idle); }
+			if (!queue.empty()) { pthread_cond_broadcast(&cond_queue); }
+			pthread_mutex_unlock(&mutex);
+
+			AsyncJobState::release(job);
+		}
+	}
+
+	std::vector<Worker*> workers;
+	std::vector<AsyncJobState*> queue;
+	int max_queue;
+	bool stopping;
+	long long next_seq;
+	int num_busy;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond_queue;  // new jobs or stopping, for the workers
+	pthread_cond_t cond_space;  // free space in the queue, for submit()
+	pthread_cond_t cond_idle;   // queue empty and all workers idle, for wait_all()
+};
+
+
+
+AsyncSolver::AsyncSolver(int num_workers, int max_queue) : implementation(new AsyncSolverImplementation(num_workers, max_queue)) {}
+AsyncSolver::~AsyncSolver() { delete implementation; }
+AsyncJob AsyncSolver::submit(const BaseImage *in, const Par &par, int priority)
+{
+	return implementation->submit(in, par, priority, true);
+}
+AsyncJob AsyncSolver::try_submit(const BaseImage *in, const Par &par, int priority)
+{
+	return implementation->submit(in, par, priority, false);
+}
+void AsyncSolver::wait_all() { implementation->wait_all(); }
+int AsyncSolver::num_queued() { return implementation->num_queued(); }
+int AsyncSolver::num_workers() { return implementation->num_workers(); }
@@ -0,0 +1,110 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SOLVER_ASYNC_H
+#define SOLVER_ASYNC_H
+
+#include "solver.h"
+
+
+
+// p_impl design pattern to reduce header to the minimum in order to avoid unnecessary dependencies
+class AsyncSolverImplementation;
+struct AsyncJobState;
+
+
+// Handle to a job submitted to an AsyncSolver, similar to a future.
+// Handles can be copied, all copies refer to the same job. The job state is freed when the last handle is gone,
+// a job whose handles are all gone before it has finished is still computed, and its result is deleted.
+class AsyncJob
+{
+public:
+	AsyncJob();
+	AsyncJob(const AsyncJob &other_job);
+	AsyncJob& operator= (const AsyncJob &other_job);
+	~AsyncJob();
+
+	// Whether this handle refers to a job. False for default constructed handles and if AsyncSolver::try_submit() rejected the job.
+	bool is_valid() const;
+
+	// Whether the job has finished, without blocking.
+	bool is_done() const;
+
+	// Blocks until the job has finished.
+	void wait() const;
+
+	// Blocks until the job has finished and returns the result, the caller takes the ownership of it.
+	// Returns the result only once, subsequent calls return NULL.
+	BaseImage* get_result();
+
+	// Blocks until the job has finished and returns the number of iterations, the energy etc. of the result.
+	RunInfo get_run_info() const;
+
+private:
+	friend class AsyncSolverImplementation;
+	explicit AsyncJob(AsyncJobState *state);
+
+	AsyncJobState *state;
+};
+
+
+// Asynchronous front end to Solver for concurrent requests, e.g. in a service.
+// A fixed number of worker threads, each with its own Solver instance, consume a bounded queue of jobs.
+// Jobs with higher priority are started first, jobs with the same priority in the order of submission.
+// An idle worker prefers jobs with the same image size, precision and engine as its previous job,
+// so that it reuses its memory allocation instead of reallocating.
+//
+// The input image is not copied: It must stay valid and unchanged until the job has finished.
+// Each worker keeps the state of its previous job, so temporal regularization and incremental
+// have no well defined "previous frame" here and should not be used with AsyncSolver.
+class AsyncSolver
+{
+public:
+	// num_workers: Number of worker threads, i.e. of jobs computed at the same time (at least 1).
+	// max_queue: Maximal number of jobs waiting to be started (at least 1).
+	AsyncSolver(int num_workers = 1, int max_queue = 16);
+
+	// Computes all jobs still in the queue, then stops the workers.
+	~AsyncSolver();
+
+	// Adds a job to the queue. Blocks while the queue is full (backpressure).
+	AsyncJob submit(const BaseImage *in, const Par &par, int priority = 0);
+
+	// Adds a job to the queue if it is not full. Otherwise returns immediately with an invalid handle, see AsyncJob::is_valid().
+	AsyncJob try_submit(const BaseImage *in, const Par &par, int priority = 0);
+
+	// Blocks until the queue is empty and all workers are idle.
+	void wait_all();
+
+	// Number of jobs waiting to be started.
+	int num_queued();
+
+	int num_workers();
+
+private:
+	AsyncSolver(const AsyncSolver &other_solver);  // disable
+	AsyncSolver& operator= (const AsyncSolver &other_solver);  // disable
+
+	AsyncSolverImplementation *implementation;
+};
+
+
+
+#endif // SOLVER_ASYNC_H
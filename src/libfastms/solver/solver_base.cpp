@@ -19,7 +19,15 @@
 
 #include "solver_base.h"
 #include <cstdio>  // for snprintf
+#include <algorithm>  // for std::sort, std::min
 #include "util/timer.h"
+#include "util/mem.h"
+#include "solver_upsample.h"
+#include "solver_luma_chroma.h"
+
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+#include <omp.h>
+#endif
 
 
 
@@ -28,6 +36,20 @@ SolverBase<real>::SolverBase()
 {
 	engine = NULL;
 	u_is_computed = false;
+	energy_batch_1d = real(0);
+	incremental_run = false;
+	prev_f_is_set = false;
+	time_budget_loop_start = 0.0;
+	time_budget_next_check = 1;
+	last_change = real(0);
+	last_change_iteration = -1;
+	crop_x0 = 0;
+	crop_y0 = 0;
+	chroma_u_is_computed = false;
+	region_x0 = 0;
+	region_y0 = 0;
+	weight_sigma = real(0);
+	weight_guide = NULL;
 }
 
 
@@ -59,6 +81,8 @@ template<typename real>
 void SolverBase<real>::free()
 {
 	arr.free(engine);
+	chroma_arr.free(engine);
+	lane_arr.free(engine);
 	engine->free();
 }
 
@@ -66,38 +90,312 @@ void SolverBase<real>::free()
 template<typename real>
 void SolverBase<real>::init(const BaseImage *image)
 {
-	image->copy_to_layered(arr.f.get_untyped_access());
-	if (par.temporal == real(0)) { u_is_computed = false; }
+	// use the input directly if possible, without copying it to arr.f
+	ImageUntypedAccess<DataInterpretationLayered> view;
+	if (image->get_layered_view(&view) && view.elem_kind() == ElemType2Kind<real>::value &&
+		view.is_on_host() == engine->image_manager()->is_on_host() && view.dim() == arr.u.dim())
+	{
+		f_in = view.get_access<real>();
+	}
+	else
+	{
+		engine->image_manager()->alloc(arr.f, arr.u.dim());
+		image->copy_to_layered(arr.f.get_untyped_access());
+		f_in = arr.f;
+	}
+	if (par.temporal == real(0) && !par.incremental) { u_is_computed = false; }
 	if (u_is_computed)
 	{
 		engine->image_manager()->copy_from_samekind(arr.prev_u, arr.u);
 	}
-	engine->image_manager()->copy_from_samekind(arr.u, arr.f);
+	stats.num_tiles = 0;
+	stats.num_tiles_active = 0;
+	incremental_run = (u_is_computed && init_incremental());
+	if (incremental_run)
+	{
+		// keep u and p of the previous run, only the changed tiles start anew from f
+		reset_changed_tiles();
+	}
+	else
+	{
+		engine->image_manager()->copy_from_samekind(arr.u, f_in);
+		engine->image_manager()->setzero(arr.p);
+	}
 	engine->image_manager()->copy_from_samekind(arr.ubar, arr.u);
-	engine->image_manager()->setzero(arr.p);
-    if (par.weight)
+    if (weight_guide)
+    {
+    	// weight from another image with one channel (the luma solution for the chroma solve)
+    	image_access_t guide = get_channel(arr.aux_result, 0);
+    	weight_guide->copy_to_layered(guide.get_untyped_access());
+    	set_regularizer_weight_from(guide, real(0));
+    }
+    else if (par.weight)
     {
-	    set_regularizer_weight_from(arr.f);
+	    set_regularizer_weight_from(f_in, weight_sigma);
+    }
+    pd_vars.init(par, f_in, arr.regularizer_weight, (u_is_computed? arr.prev_u : image_access_t()));
+
+    // remember f and the parameters for the change detection in the next run
+    prev_f_is_set = (par.incremental && f_in.is_on_host() && engine->has_tiles());
+    if (prev_f_is_set)
+    {
+    	host_arr.prev_f.alloc(f_in.dim());
+    	engine->image_manager()->copy_from_samekind(host_arr.prev_f.get_access(), f_in);
+    	prev_f_par = par;
     }
-    pd_vars.init(par, arr.f, arr.regularizer_weight, (u_is_computed? arr.prev_u : image_access_t()));
 }
 
 
 template<typename real>
-void SolverBase<real>::set_regularizer_weight_from(image_access_t image)
+bool SolverBase<real>::init_incremental()
 {
+	if (!par.incremental || !prev_f_is_set || !engine->has_tiles() || !f_in.is_on_host() || host_arr.prev_f.dim() != f_in.dim()) { return false; }
+
+	// the solution of the unchanged tiles is only valid for the same model
+	if (!par.same_model_as(prev_f_par)) { return false; }
+
+	// tiles in which f has changed
+	image_access_t f = f_in;
+	image_access_t prev_f = host_arr.prev_f.get_access();
+	const ArrayDim &dim = f.dim();
+	const int tile_size = incremental_tile_size;
+	const int num_tiles_x = (dim.w + tile_size - 1) / tile_size;
+	const int num_tiles_y = (dim.h + tile_size - 1) / tile_size;
+	const int num_tiles = num_tiles_x * num_tiles_y;
+	const real eps = (real)par.incremental_eps;
+	tile_is_changed.assign(num_tiles, 0);
+	int num_changed = 0;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	#pragma omp parallel for reduction(+: num_changed)
+#endif
+	for (int t = 0; t < num_tiles; t++)
+	{
+		const int x0 = tile_size * (t % num_tiles_x);
+		const int y0 = tile_size * (t / num_tiles_x);
+		const int x1 = std::min(x0 + tile_size, dim.w);
+		const int y1 = std::min(y0 + tile_size, dim.h);
+		bool is_changed = false;
+		for (int i = 0; i < dim.num_channels && !is_changed; i++)
+		{
+			for (int y = y0; y < y1 && !is_changed; y++)
+			{
+				for (int x = x0; x < x1 && !is_changed; x++)
+				{
+					is_changed = (realabs(f.get(x, y, i) - prev_f.get(x, y, i)) > eps);
+				}
+			}
+		}
+		tile_is_changed[t] = is_changed;
+		num_changed += (is_changed? 1 : 0);
+	}
+	if ((double)num_changed > par.incremental_max_fraction * num_tiles) { return false; }
+
+	// dilate by one tile, so that the changes can propagate to the neighborhood
+	incremental_tiles.clear();
+	for (int ty = 0; ty < num_tiles_y; ty++)
+	{
+		for (int tx = 0; tx < num_tiles_x; tx++)
+		{
+			bool is_active = false;
+			for (int ny = std::max(ty - 1, 0); ny <= std::min(ty + 1, num_tiles_y - 1) && !is_active; ny++)
+			{
+				for (int nx = std::max(tx - 1, 0); nx <= std::min(tx + 1, num_tiles_x - 1) && !is_active; nx++)
+				{
+					is_active = tile_is_changed[nx + num_tiles_x * ny];
+				}
+			}
+			if (is_active) { incremental_tiles.push_back(tx + num_tiles_x * ty); }
+		}
+	}
+	stats.num_tiles = num_tiles;
+	stats.num_tiles_active = (int)incremental_tiles.size();
+	return true;
+}
+
+
+template<typename real>
+void SolverBase<real>::reset_changed_tiles()
+{
+	image_access_t u = arr.u;
+	image_access_t f = f_in;
+	image_access_t p = arr.p;
+	const ArrayDim &dim = u.dim();
+	const int p_num_channels = p.dim().num_channels;
+	const int tile_size = incremental_tile_size;
+	const int num_tiles_x = (dim.w + tile_size - 1) / tile_size;
+	const int num_tiles = (int)tile_is_changed.size();
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	#pragma omp parallel for
+#endif
+	for (int t = 0; t < num_tiles; t++)
+	{
+		if (!tile_is_changed[t]) { continue; }
+		const int x0 = tile_size * (t % num_tiles_x);
+		const int y0 = tile_size * (t / num_tiles_x);
+		const int x1 = std::min(x0 + tile_size, dim.w);
+		const int y1 = std::min(y0 + tile_size, dim.h);
+		for (int y = y0; y < y1; y++)
+		{
+			for (int x = x0; x < x1; x++)
+			{
+				for (int i = 0; i < dim.num_channels; i++) { u.get(x, y, i) = f.get(x, y, i); }
+				for (int i = 0; i < p_num_channels; i++) { p.get(x, y, i) = real(0); }
+			}
+		}
+	}
+}
+
+
+template<typename real>
+void SolverBase<real>::run_incremental()
+{
+	if (incremental_tiles.empty())
+	{
+		// f has not changed, the previous solution is kept
+		stats.stop_iteration = 0;
+		return;
+	}
+	const int *tiles = &incremental_tiles[0];
+	const int num_tiles = (int)incremental_tiles.size();
+	const int tile_size = incremental_tile_size;
+	const Dim2D &dim2d = arr.u.dim().dim2d();
+	const int num_tiles_x = (dim2d.w + tile_size - 1) / tile_size;
+	size_t num_pixels = 0;
+	for (int k = 0; k < num_tiles; k++)
+	{
+		const int x0 = tile_size * (tiles[k] % num_tiles_x);
+		const int y0 = tile_size * (tiles[k] / num_tiles_x);
+		num_pixels += (size_t)(std::min(x0 + tile_size, dim2d.w) - x0) * (std::min(y0 + tile_size, dim2d.h) - y0);
+	}
+
+	for (int iteration = 0; iteration < par.iterations; iteration++)
+	{
+		pd_vars.update_vars();
+		engine->run_dual_p_tiles(arr.p, arr.ubar, pd_vars.linear_operator, pd_vars.regularizer, pd_vars.dt_d, tiles, num_tiles, tile_size);
+		engine->run_prim_u_tiles(arr.u, arr.ubar, arr.p, pd_vars.linear_operator, pd_vars.dataterm, pd_vars.theta_bar, pd_vars.dt_p, tiles, num_tiles, tile_size);
+		if (par.stop_k > 0 && (iteration + 1) % par.stop_k == 0)
+		{
+			real diff = engine->diff_l1_tiles(arr.u, arr.ubar, tiles, num_tiles, tile_size) / num_pixels;
+			last_change = diff / pd_vars.theta_bar;
+			last_change_iteration = iteration;
+			if (last_change <= par.stop_eps) { stats.stop_iteration = iteration; break; }
+		}
+		if (is_time_budget_over(iteration) || is_cancelled(iteration)) { stats.stop_iteration = iteration; break; }
+	}
+}
+
+
+template<typename real>
+void SolverBase<real>::set_regularizer_weight_from(image_access_t image, real sigma)
+{
+	// sigma > 0: given (computed from the whole image for a region of interest), otherwise the mean gradient norm of image
 	linear_operator_t linear_operator;
 	const Dim2D &dim2d = image.dim().dim2d();
 
 	// real gamma = real(1);
     engine->set_regularizer_weight_from__normgrad(arr.regularizer_weight, image, linear_operator);
-	real sigma = engine->get_sum(arr.regularizer_weight) / (real(dim2d.w) * real(dim2d.h));
+	if (sigma <= real(0)) { sigma = engine->get_sum(arr.regularizer_weight) / (real(dim2d.w) * real(dim2d.h)); }
 
     real coeff = (sigma > real(0)? real(2) / sigma : real(0));  // 2 = dim_image_domain
     engine->set_regularizer_weight_from__exp (arr.regularizer_weight, coeff);
 }
 
 
+template<typename real>
+void SolverBase<real>::get_weight_band_dims(const ArrayDim &dim, const Par &par, ArrayDim *dim_f, ArrayDim *dim_low, ArrayDim *dim_chroma)
+{
+	// the band arrays of get_weight_sigma(): weight_band_size rows of the solved image plus one, in full resolution (dim_f),
+	// downscaled or as luma (dim_low, empty if not needed), and the chroma (dim_chroma, empty if not needed)
+	typedef GuidedUpsampling<image_access_t> upsampling_t;
+	const int factor = std::max(1, par.downscale);
+	const bool is_luma = (factor == 1 && par.chroma_downscale > 1 && dim.num_channels == 3);
+	const int h_source = (factor > 1? upsampling_t::low_dim(dim, factor).h : dim.h);
+	const int band_rows = std::min(weight_band_size + 1, h_source);
+	*dim_f = ArrayDim(dim.w, std::min(band_rows * factor, (int)dim.h), dim.num_channels);
+	*dim_low = ArrayDim();
+	*dim_chroma = ArrayDim();
+	if (factor > 1) { *dim_low = ArrayDim(upsampling_t::low_dim(dim, factor).w, band_rows, dim.num_channels); }
+	if (is_luma)
+	{
+		*dim_low = ArrayDim(dim.w, band_rows, 1);
+		*dim_chroma = ArrayDim(dim.w, band_rows, 2);
+	}
+}
+
+
+template<typename real>
+typename SolverBase<real>::image_access_t SolverBase<real>::get_band(host_image_t &band_array, const ArrayDim &dim)
+{
+	// the first part of band_array, as an image of size dim with the pitch of band_array (fewer rows for the last band)
+	image_access_t a = band_array.get_access();
+	return image_access_t(ImageData(a.data(), dim, a.data_pitch()), a.is_on_host());
+}
+
+
+template<typename real>
+real SolverBase<real>::get_weight_sigma(const BaseImage *image, const Par &par)
+{
+	// sigma of the regularizer weight for the whole image, as set_regularizer_weight_from() computes it on the image the solver gets:
+	// downscaled for downscale > 1, the luma for chroma_downscale > 1 (the chroma weight comes from the luma solution of the region).
+	// The image is converted in bands of rows, each with one more row for the gradient in y, so only one band is in memory at a time.
+	typedef GuidedUpsampling<image_access_t> upsampling_t;
+	typedef LumaChroma<image_access_t> luma_chroma_t;
+	const ArrayDim dim = image->dim();
+	const int factor = std::max(1, par.downscale);
+	ArrayDim dim_band_f, dim_band_low, dim_band_chroma;
+	get_weight_band_dims(dim, par, &dim_band_f, &dim_band_low, &dim_band_chroma);
+	host_arr.weight_f.alloc(dim_band_f);
+	if (dim_band_low.w > 0) { host_arr.weight_low.alloc(dim_band_low); }
+	if (dim_band_chroma.w > 0) { host_arr.weight_chroma.alloc(dim_band_chroma); }
+	const int w_source = (dim_band_low.w > 0? dim_band_low.w : dim.w);
+	const int h_source = (factor > 1? upsampling_t::low_dim(dim, factor).h : dim.h);
+
+	linear_operator_t linear_operator;
+	const int u_num_channels = (dim_band_low.w > 0? dim_band_low.num_channels : dim.num_channels);
+	const int p_num_channels = linear_operator.num_channels_range(u_num_channels);
+	double sum = 0.0;
+	for (int y0 = 0; y0 < h_source; y0 += weight_band_size)
+	{
+		const int num_rows = std::min(weight_band_size, h_source - y0);
+		const int band_rows = std::min(num_rows + 1, h_source - y0);
+		image_access_t source = get_band(host_arr.weight_f, ArrayDim(dim.w, std::min(band_rows * factor, (int)dim.h - y0 * factor), dim.num_channels));
+		image->copy_region_to_layered(source.get_untyped_access(), 0, y0 * factor);
+		if (factor > 1)
+		{
+			image_access_t low = get_band(host_arr.weight_low, ArrayDim(w_source, band_rows, dim.num_channels));
+			upsampling_t::downsample(low, source, factor);
+			source = low;
+		}
+		else if (dim_band_chroma.w > 0)
+		{
+			image_access_t luma = get_band(host_arr.weight_low, ArrayDim(dim.w, band_rows, 1));
+			luma_chroma_t::from_rgb(luma, get_band(host_arr.weight_chroma, ArrayDim(dim.w, band_rows, 2)), source);
+			source = luma;
+		}
+
+		const Dim2D dim2d = source.dim().dim2d();
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp parallel reduction(+: sum)
+#endif
+		{
+			HeapArray<real> gradient_sh(p_num_channels);
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+			#pragma omp for
+#endif
+			for (int y = 0; y < num_rows; y++)
+			{
+				for (int x = 0; x < dim2d.w; x++)
+				{
+					linear_operator.apply(gradient_sh, source, x, y, dim2d, u_num_channels);
+					sum += vec_norm(gradient_sh, p_num_channels);
+				}
+			}
+		}
+	}
+	return real(sum / (double(w_source) * double(h_source)));
+}
+
+
 template<typename real>
 real SolverBase<real>::energy()
 {
@@ -126,21 +424,367 @@ bool SolverBase<real>::is_converged(int iteration)
 		return false;
 	}
 	real diff_to_prev = diff_l1(arr.u, arr.ubar) / pd_vars.theta_bar;
+	last_change = diff_to_prev;
+	last_change_iteration = iteration;
 	return (diff_to_prev <= par.stop_eps);
 }
 
 
+// reset the time budget and the progress state before the iterations
+template<typename real>
+void SolverBase<real>::start_loop_checks()
+{
+	time_budget_loop_start = timer_budget.get_elapsed();
+	time_budget_next_check = 1;
+	last_change = real(0);
+	last_change_iteration = -1;
+}
+
+
+template<typename real>
+bool SolverBase<real>::is_time_budget_over(int iteration)
+{
+	if (par.time_budget <= 0.0 || iteration + 1 < time_budget_next_check)
+	{
+		return false;
+	}
+
+	// calibrate the cost per iteration on the iterations done so far
+	engine->synchronize();
+	double elapsed = timer_budget.get_elapsed();
+	double cost_per_iteration = (elapsed - time_budget_loop_start) / (iteration + 1);
+	double remaining = par.time_budget - elapsed;
+
+	// the next iteration must fit, and about as much time as the initialization took is kept for the energy and the copying of the result
+	if (remaining < cost_per_iteration + time_budget_loop_start)
+	{
+		stats.time_budget_exceeded = true;
+		return true;
+	}
+
+	// check again after about half of the remaining time, so that there are only a few checks
+	int num_iterations_ahead = (cost_per_iteration > 0.0? (int)std::min(0.5 * remaining / cost_per_iteration, (double)par.iterations) : par.iterations);
+	time_budget_next_check = iteration + 1 + std::max(num_iterations_ahead, 1);
+	return false;
+}
+
+
+template<typename real>
+bool SolverBase<real>::is_cancelled(int iteration)
+{
+	if (!par.progress_callback || par.progress_k <= 0 || (iteration + 1) % par.progress_k != 0)
+	{
+		return false;
+	}
+	ProgressInfo info;
+	info.iteration = iteration + 1;
+	info.change = (last_change_iteration == iteration? last_change : diff_l1(arr.u, arr.ubar) / pd_vars.theta_bar);
+	info.u = arr.u.const_data();
+	info.u_is_double = (sizeof(real) == sizeof(double));
+	info.u_is_on_host = arr.u.is_on_host();
+	info.u_pitch = arr.u.data_pitch();
+	info.w = arr.u.dim().w;
+	info.h = arr.u.dim().h;
+	info.num_channels = arr.u.dim().num_channels;
+	engine->synchronize();
+	stats.cancelled = !par.progress_callback(info, par.progress_user_data);
+	return stats.cancelled;
+}
+
+
+template<typename real>
+typename SolverBase<real>::image_access_t SolverBase<real>::to_host(image_access_t a, host_image_t &host_image, bool copy_data)
+{
+	if (!a.is_valid() || a.is_on_host()) { return a; }
+	host_image.alloc(a.dim());
+	if (copy_data) { copy_image(host_image.get_untyped_access(), a.get_untyped_access()); }
+	return host_image.get_access();
+}
+
+
+template<typename real>
+void SolverBase<real>::from_host(image_access_t a, image_access_t a_host)
+{
+	if (a.is_on_host()) { return; }
+	copy_image(a.get_untyped_access(), a_host.get_untyped_access());
+}
+
+
+template<typename real>
+bool SolverBase<real>::run_special_solver()
+{
+	if (par.batch_1d != Par::batch_1d_none)
+	{
+		image_access_t u = to_host(arr.u, host_arr.u, false);
+		image_access_t f = to_host(f_in, host_arr.f, true);
+		image_access_t regularizer_weight = (par.weight? to_host(arr.regularizer_weight, host_arr.regularizer_weight, true) : image_access_t());
+		energy_batch_1d = run_solver_1d(u, f, regularizer_weight, par.batch_1d == Par::batch_1d_rows, pd_vars.regularizer.alpha, pd_vars.regularizer.lambda);
+		from_host(arr.u, u);
+		stats.stop_iteration = 0;
+		return true;
+	}
+	if (!par.special_solvers || pd_vars.dataterm.has_temporal()) { return false; }
+	const ArrayDim &dim = arr.u.dim();
+	if (dim.h == 1 || dim.w == 1)
+	{
+		image_access_t u = to_host(arr.u, host_arr.u, false);
+		image_access_t f = to_host(f_in, host_arr.f, true);
+		image_access_t regularizer_weight = (par.weight? to_host(arr.regularizer_weight, host_arr.regularizer_weight, true) : image_access_t());
+		run_solver_1d(u, f, regularizer_weight, dim.h == 1, pd_vars.regularizer.alpha, pd_vars.regularizer.lambda);
+		from_host(arr.u, u);
+		stats.stop_iteration = 0;
+		return true;
+	}
+	if (par.alpha < 0)
+	{
+		image_access_t u = to_host(arr.u, host_arr.u, false);
+		image_access_t f = to_host(f_in, host_arr.f, true);
+		image_access_t regularizer_weight = (par.weight? to_host(arr.regularizer_weight, host_arr.regularizer_weight, true) : image_access_t());
+		int num_iterations = region_fusion.run(u, f, regularizer_weight, pd_vars.regularizer.lambda);
+		from_host(arr.u, u);
+		stats.stop_iteration = num_iterations - 1;
+		return true;
+	}
+	return false;
+}
+
+
+template<typename real>
+real SolverBase<real>::run_solver_1d(image_access_t u, image_access_t f, image_access_t regularizer_weight, bool along_x, real alpha, real lambda,
+		image_access_t coupling, image_access_t coupling_dual, real coupling_dual_sign, real mu)
+{
+	// Every row (along_x) or every column is solved independently, the returned value is the sum of the 1d energies.
+	// If coupling is given, the data of the 1d problems is (f + mu * (coupling + coupling_dual_sign * coupling_dual)) / (1 + mu).
+	const ArrayDim &dim = u.dim();
+	const int n = (along_x? dim.w : dim.h);
+	const int num_lines = (along_x? dim.h : dim.w);
+	const int num_channels = dim.num_channels;
+	const bool is_coupled = coupling.is_valid();
+	host_arr.lines_f.alloc(lines_1d_dim(dim, num_channels));
+	host_arr.lines_u.alloc(lines_1d_dim(dim, num_channels));
+	if (regularizer_weight.is_valid()) { host_arr.lines_weight.alloc(lines_1d_dim(dim, 1)); }
+	image_access_t lines_f = host_arr.lines_f.get_access();
+	image_access_t lines_u = host_arr.lines_u.get_access();
+	image_access_t lines_weight = host_arr.lines_weight.get_access();
+	solvers_1d.resize(lines_f.dim().h);
+	double energy_sum = 0.0;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	#pragma omp parallel reduction(+: energy_sum)
+#endif
+	{
+		int thread = 0;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		thread = omp_get_thread_num();
+#endif
+		ExactSolver1D<real> &solver_1d = solvers_1d[thread];
+		real *f_1d = &lines_f.get(0, thread, 0);
+		real *u_1d = &lines_u.get(0, thread, 0);
+		real *weight_1d = (regularizer_weight.is_valid()? &lines_weight.get(0, thread, 0) : NULL);
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp for schedule(dynamic)
+#endif
+		for (int line = 0; line < num_lines; line++)
+		{
+			for (int k = 0; k < n; k++)
+			{
+				int x = (along_x? k : line);
+				int y = (along_x? line : k);
+				for (int i = 0; i < num_channels; i++)
+				{
+					real val = f.get(x, y, i);
+					if (is_coupled) { val = (val + mu * (coupling.get(x, y, i) + coupling_dual_sign * coupling_dual.get(x, y, i))) / (real(1) + mu); }
+					f_1d[k + (size_t)n * i] = val;
+				}
+				if (regularizer_weight.is_valid()) { weight_1d[k] = regularizer_weight.get(x, y, 0); }
+			}
+			energy_sum += solver_1d.run(u_1d, f_1d, weight_1d, n, num_channels, alpha, lambda);
+			for (int k = 0; k < n; k++)
+			{
+				int x = (along_x? k : line);
+				int y = (along_x? line : k);
+				for (int i = 0; i < num_channels; i++) { u.get(x, y, i) = u_1d[k + (size_t)n * i]; }
+			}
+		}
+	}
+	return (real)energy_sum / (pd_vars.scale_omega * pd_vars.scale_omega);
+}
+
+
+template<typename real>
+ArrayDim SolverBase<real>::lines_1d_dim(const ArrayDim &dim, int num_channels)
+{
+	// one row per thread, long enough for the rows and for the columns of dim
+	int num_threads = 1;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	num_threads = omp_get_max_threads();
+#endif
+	return ArrayDim(std::max(dim.w, dim.h) * num_channels, num_threads, 1);
+}
+
+
+template<typename real>
+void SolverBase<real>::run_admm()
+{
+	// ADMM for  min_{u = v}  1/2 |u - f|^2 + R_x(u)  +  1/2 |v - f|^2 + R_y(v),
+	// with R_x, R_y the regularizer on the x and y differences. Both subproblems decompose into independent 1d problems:
+	//   u = arg min  |u - (f + mu * (v - w)) / (1 + mu)|^2 + 2 / (1 + mu) * R_x(u),  along the rows,
+	//   v = arg min  |v - (f + mu * (u + w)) / (1 + mu)|^2 + 2 / (1 + mu) * R_y(v),  along the columns,
+	//   w = w + u - v.
+	// The penalty mu is doubled in every iteration, which makes the (nonconvex) iterations converge to u = v. w is the scaled dual variable,
+	// so it is scaled by mu / mu_next when mu changes. mu is capped at mu_max: beyond it f has almost no influence on the 1d problems
+	// in float precision. The iterations go on at mu_max until u and v agree up to par.stop_eps, otherwise the run is not converged.
+	// ubar and aux_result are not needed otherwise here, and hold v and w.
+	image_access_t u = arr.u;
+	image_access_t v = arr.ubar;
+	image_access_t w = arr.aux_result;
+	engine->image_manager()->setzero(w);
+	const real alpha = pd_vars.regularizer.alpha;
+	const real lambda = pd_vars.regularizer.lambda;
+	const bool alpha_infinite = !(alpha >= real(0) && alpha < realmax<real>());
+	const bool lambda_infinite = !(lambda >= real(0) && lambda < realmax<real>());
+	const ArrayDim &dim = u.dim();
+	const int num_channels = dim.num_channels;
+	const real mu_max = real(1e4);
+	real mu = real(1);
+	for (int iteration = 0; iteration < par.iterations; iteration++)
+	{
+		real factor = real(2) / (real(1) + mu);
+		real alpha_1d = (alpha_infinite? alpha : factor * alpha);
+		real lambda_1d = (lambda_infinite? lambda : factor * lambda);
+		run_solver_1d(u, f_in, pd_vars.regularizer.weight, true, alpha_1d, lambda_1d, v, w, real(-1), mu);
+		run_solver_1d(v, f_in, pd_vars.regularizer.weight, false, alpha_1d, lambda_1d, u, w, real(1), mu);
+		const real mu_next = std::min(real(2) * mu, mu_max);
+		const real w_scale = mu / mu_next;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp parallel for
+#endif
+		for (int y = 0; y < dim.h; y++)
+		{
+			for (int x = 0; x < dim.w; x++)
+			{
+				for (int i = 0; i < num_channels; i++) { w.get(x, y, i) = (w.get(x, y, i) + u.get(x, y, i) - v.get(x, y, i)) * w_scale; }
+			}
+		}
+		if (par.stop_k > 0 && (iteration + 1) % par.stop_k == 0)
+		{
+			last_change = diff_l1(u, v);
+			last_change_iteration = iteration;
+			if (last_change <= par.stop_eps) { stats.stop_iteration = iteration; break; }
+		}
+		if (is_time_budget_over(iteration) || is_cancelled(iteration)) { stats.stop_iteration = iteration; break; }
+		mu = mu_next;
+	}
+}
+
+
 template<typename real>
 BaseImage* SolverBase<real>::get_solution(const BaseImage *image)
 {
 	engine->image_manager()->copy_from_samekind(arr.aux_result, arr.u);
+	return get_solution_from_aux_result(image, pd_vars.regularizer);
+}
+
+
+template<typename real>
+BaseImage* SolverBase<real>::get_solution_from_aux_result(const BaseImage *image, regularizer_t regularizer)
+{
+    BaseImage* out_image = image->new_of_same_type_and_size();
+    copy_solution_from_aux_result(out_image, regularizer);
+    return out_image;
+}
+
+
+template<typename real>
+void SolverBase<real>::copy_solution_from_aux_result(BaseImage *out_image, regularizer_t regularizer)
+{
 	if (par.edges)
 	{
-		engine->add_edges(arr.aux_result, pd_vars.linear_operator, pd_vars.regularizer);
+		engine->add_edges(arr.aux_result, pd_vars.linear_operator, regularizer);
+	}
+	if (crop_dim.num_elem() == 0)
+	{
+		out_image->copy_from_layered(arr.aux_result.get_untyped_access());
+		return;
+	}
+	write_cropped(out_image, to_host(arr.aux_result, host_arr.u, true));
+}
+
+
+template<typename real>
+void SolverBase<real>::write_cropped(BaseImage *out_image, image_access_t result)
+{
+	// region of interest: crop the halo
+	host_arr.roi.alloc(crop_dim);
+	copy_image_region_h2h(host_arr.roi.get_untyped_access(), 0, 0, result.get_untyped_access(), crop_x0, crop_y0, crop_dim);
+	out_image->copy_from_layered(host_arr.roi.get_untyped_access());
+}
+
+
+template<typename real>
+typename SolverBase<real>::image_access_t SolverBase<real>::get_channel(image_access_t a, int i)
+{
+	// channel i of a layered array, as an array with one channel
+	const ArrayDim &dim = a.dim();
+	void *data = (void*)((char*)a.data() + a.data_pitch() * dim.h * i);
+	return image_access_t(ImageData(data, ArrayDim(dim.w, dim.h, 1), a.data_pitch()), a.is_on_host());
+}
+
+
+template<typename real>
+bool SolverBase<real>::can_run_lanes(const BaseImage *image, const std::vector<Par> &pars)
+{
+	if (pars.size() < 2 || !engine->has_lanes()) { return false; }
+	const ArrayDim &dim = image->dim();
+	const Par &par0 = pars[0];
+	for (size_t k = 0; k < pars.size(); k++)
+	{
+		// f, the weight and the step sizes are shared, so only lambda, alpha and edges may differ
+		const Par &par_k = pars[k];
+		if (par_k.temporal != 0.0 || par_k.iterations != par0.iterations || par_k.stop_eps != par0.stop_eps || par_k.stop_k != par0.stop_k ||
+			par_k.adapt_params != par0.adapt_params || par_k.weight != par0.weight)
+		{
+			return false;
+		}
+
+		// parameter sets solved by other solvers
+		if (par_k.engine == Par::engine_cpu_admm || par_k.batch_1d != Par::batch_1d_none || par_k.incremental || par_k.time_budget > 0.0 || par_k.progress_callback || par_k.has_roi() || par_k.downscale > 1 || par_k.chroma_downscale > 1) { return false; }
+		if (par_k.special_solvers && (par_k.alpha < 0 || dim.w == 1 || dim.h == 1)) { return false; }
+	}
+	return true;
+}
+
+
+template<typename real>
+void SolverBase<real>::run_lanes(std::vector<regularizer_t> &regularizers, std::vector<real> &energies)
+{
+	const int num_lanes = (int)regularizers.size();
+	const Dim2D &dim2d = arr.u.dim().dim2d();
+	for (int iteration = 0; iteration < par.iterations; iteration++)
+	{
+		pd_vars.update_vars();
+		engine->run_dual_p_lanes(lane_arr.p, lane_arr.ubar, pd_vars.linear_operator, &regularizers[0], num_lanes, pd_vars.dt_d);
+		engine->run_prim_u_lanes(lane_arr.u, lane_arr.ubar, lane_arr.p, pd_vars.linear_operator, pd_vars.dataterm, num_lanes, pd_vars.theta_bar, pd_vars.dt_p);
+
+		// stop when all lanes are converged
+		if (par.stop_k > 0 && (iteration + 1) % par.stop_k == 0)
+		{
+			engine->diff_l1_base_lanes(lane_arr.u, lane_arr.ubar, lane_arr.aux_reduce, num_lanes);
+			bool is_converged = true;
+			for (int k = 0; k < num_lanes && is_converged; k++)
+			{
+				real diff = engine->get_sum(get_channel(lane_arr.aux_reduce, k)) / ((size_t)dim2d.w * dim2d.h);
+				is_converged = (diff / pd_vars.theta_bar <= par.stop_eps);
+			}
+			if (is_converged) { stats.stop_iteration = iteration; break; }
+		}
+	}
+
+	engine->energy_base_lanes(lane_arr.u, lane_arr.aux_reduce, pd_vars.linear_operator, pd_vars.dataterm, &regularizers[0], num_lanes);
+	energies.resize(num_lanes);
+	for (int k = 0; k < num_lanes; k++)
+	{
+		energies[k] = engine->get_sum(get_channel(lane_arr.aux_reduce, k)) / (pd_vars.scale_omega * pd_vars.scale_omega);
 	}
-    BaseImage* out_image = image->new_of_same_type_and_size();
-	out_image->copy_from_layered(arr.aux_result.get_untyped_access());
-    return out_image;
 }
 
 
@@ -160,7 +804,15 @@ void SolverBase<real>::print_stats()
 	{
 		snprintf(buffer, sizeof(buffer), ", average %2.4f s / %2.4f s (+ %2.4f)", stats.time_compute_sum / stats.num_runs, stats.time_sum / stats.num_runs, (stats.time_sum - stats.time_compute_sum) / stats.num_runs); std::cout << buffer;
 	}
-	if (stats.stop_iteration != -1)
+	if (stats.time_budget_exceeded)
+	{
+		std::cout << ", " << (stats.stop_iteration + 1) << " iterations (stopped by time budget)";
+	}
+	else if (stats.cancelled)
+	{
+		std::cout << ", " << (stats.stop_iteration + 1) << " iterations (cancelled)";
+	}
+	else if (stats.stop_iteration != -1)
 	{
 		std::cout << ", " << (stats.stop_iteration + 1) << " iterations";
 	}
@@ -180,18 +832,300 @@ void SolverBase<real>::print_stats()
 	{
 		std::cout << ", weighting";
 	}
+	if (stats.num_tiles > 0)
+	{
+		std::cout << ", incremental " << stats.num_tiles_active << " of " << stats.num_tiles << " tiles";
+	}
 	std::cout << ", energy ";
 	snprintf(buffer, sizeof(buffer), "%4.4f", stats.energy); std::cout << buffer;
 	std::cout << std::endl;
 }
 
 
+template<typename real>
+void SolverBase<real>::compute()
+{
+	engine->timer_start();
+    stats.stop_iteration = -1;
+    stats.time_budget_exceeded = false;
+    stats.cancelled = false;
+    start_loop_checks();
+    if (!run_special_solver())
+    {
+        if (par.engine == Par::engine_cpu_admm && !pd_vars.dataterm.has_temporal())
+        {
+            run_admm();
+        }
+        else if (incremental_run)
+        {
+            run_incremental();
+        }
+        else
+        {
+            for (int iteration = 0; iteration < par.iterations; iteration++)
+            {
+            	pd_vars.update_vars();
+            	engine->run_dual_p(arr.p, arr.ubar, pd_vars.linear_operator, pd_vars.regularizer, pd_vars.dt_d);
+            	engine->run_prim_u(arr.u, arr.ubar, arr.p, pd_vars.linear_operator, pd_vars.dataterm, pd_vars.theta_bar, pd_vars.dt_p);
+            	if (is_converged(iteration)) { stats.stop_iteration = iteration; break; }
+            	if (is_time_budget_over(iteration) || is_cancelled(iteration)) { stats.stop_iteration = iteration; break; }
+            }
+        }
+    }
+    engine->timer_end();
+    u_is_computed = !stats.cancelled;  // a cancelled solution is not used as the previous frame
+    stats.time_compute = engine->timer_get();
+    stats.time_compute_sum += stats.time_compute;
+    stats.num_runs++;
+    stats.energy = (par.batch_1d != Par::batch_1d_none? energy_batch_1d : energy());
+}
+
+
+template<typename real>
+size_t SolverBase<real>::host_image_size(const ArrayDim &dim)
+{
+	return Engine<real>::data_interpretation_t::used_data_dim(dim, sizeof(real)).num_bytes();
+}
+
+
+template<typename real>
+size_t SolverBase<real>::estimate_memory(const ArrayDim &dim_u, const Par &par)
+{
+	// the same cases as in run_into(): region of interest, downscaled, luma and chroma, each with the host arrays of its run_*_into()
+	typedef GuidedUpsampling<image_access_t> upsampling_t;
+	typename Engine<real>::image_manager_base_t *image_manager = engine->image_manager();
+	if (par.has_roi())
+	{
+		int x0, y0;
+		ArrayDim dim_region;
+		par.get_roi_region(dim_u, &x0, &y0, &dim_region);
+		Par region_par = par.adapted_to(dim_u);
+		region_par.roi_w = 0;
+		region_par.roi_h = 0;
+		size_t mem = host_image_size(par.result_dim(dim_u));
+		if (!image_manager->is_on_host()) { mem += host_image_size(dim_region); }
+		if (par.weight)
+		{
+			ArrayDim dim_band_f, dim_band_low, dim_band_chroma;
+			get_weight_band_dims(dim_u, par, &dim_band_f, &dim_band_low, &dim_band_chroma);
+			mem += host_image_size(dim_band_f);
+			if (dim_band_low.w > 0) { mem += host_image_size(dim_band_low); }
+			if (dim_band_chroma.w > 0) { mem += host_image_size(dim_band_chroma); }
+		}
+		return mem + estimate_memory(dim_region, region_par);
+	}
+	if (par.downscale > 1)
+	{
+		const ArrayDim dim_low = upsampling_t::low_dim(dim_u, par.downscale);
+		Par par_low = par;
+		par_low.downscale = 1;
+		par_low.chroma_downscale = 1;
+		par_low.edges = false;
+		return 2 * host_image_size(dim_u) + 2 * host_image_size(dim_low) + estimate_memory(dim_low, par_low);
+	}
+	if (par.chroma_downscale > 1 && dim_u.num_channels == 3)
+	{
+		const ArrayDim dim_luma(dim_u.w, dim_u.h, 1);
+		const ArrayDim dim_chroma(dim_u.w, dim_u.h, 2);
+		const ArrayDim dim_low = upsampling_t::low_dim(dim_chroma, par.chroma_downscale);
+		Par par_luma = par;
+		par_luma.chroma_downscale = 1;
+		par_luma.edges = false;
+		par_luma.incremental = false;
+		Par par_chroma = par_luma;
+		par_chroma.weight = true;
+		size_t mem = host_image_size(dim_u) + 2 * host_image_size(dim_luma) + 2 * host_image_size(dim_chroma);
+		mem += 2 * host_image_size(dim_low) + host_image_size(ArrayDim(dim_low.w, dim_low.h, 1));
+		return mem + estimate_memory(dim_luma, par_luma) + estimate_memory(dim_low, par_chroma);
+	}
+
+	// the arrays of Arrays::alloc, and arr.f for an input which can not be used directly
+	const ArrayDim dim_p = linear_operator_t::dim_range(dim_u);
+	const ArrayDim dim_scalar(dim_u.w, dim_u.h, 1);
+	size_t mem = 5 * image_manager->alloc_size(dim_u) + image_manager->alloc_size(dim_p) + 2 * image_manager->alloc_size(dim_scalar);
+
+	// the solvers which run on the host only, with host copies of u, f and the weight if the engine is not on the host
+	const bool is_1d = (dim_u.w == 1 || dim_u.h == 1);
+	if (par.batch_1d != Par::batch_1d_none || (par.special_solvers && (is_1d || par.alpha < 0)))
+	{
+		if (!image_manager->is_on_host())
+		{
+			mem += 2 * host_image_size(dim_u);
+			if (par.weight) { mem += host_image_size(dim_scalar); }
+		}
+		if (par.batch_1d == Par::batch_1d_none && !is_1d) { mem += RegionFusion<image_access_t>::memory(dim_u); }
+	}
+	if (par.batch_1d != Par::batch_1d_none || (par.special_solvers && is_1d) || par.engine == Par::engine_cpu_admm)
+	{
+		mem += 2 * host_image_size(lines_1d_dim(dim_u, dim_u.num_channels));
+		if (par.weight) { mem += host_image_size(lines_1d_dim(dim_u, 1)); }
+	}
+
+	// the input of the previous run for the incremental mode
+	if (par.incremental && engine->has_tiles() && image_manager->is_on_host())
+	{
+		mem += host_image_size(dim_u);
+	}
+
+	// not on the host: a temporary device copy of the input (or the result) for the conversion from (or to) other image types
+	if (!image_manager->is_on_host())
+	{
+		mem += image_manager->alloc_size(dim_u);
+	}
+	return mem;
+}
+
+
+template<typename real>
+void SolverBase<real>::reserve(const ArrayDim &dim_u, const Par &par_const)
+{
+	// the same cases as estimate_memory()
+	typedef GuidedUpsampling<image_access_t> upsampling_t;
+	if (!engine->is_valid()) { return; }
+	if (par_const.has_roi())
+	{
+		int x0, y0;
+		ArrayDim dim_region;
+		par_const.get_roi_region(dim_u, &x0, &y0, &dim_region);
+		Par region_par = par_const.adapted_to(dim_u);
+		region_par.roi_w = 0;
+		region_par.roi_h = 0;
+		host_arr.roi.alloc(par_const.result_dim(dim_u));
+		if (!engine->image_manager()->is_on_host()) { host_arr.u.alloc(dim_region); }
+		if (par_const.weight)
+		{
+			ArrayDim dim_band_f, dim_band_low, dim_band_chroma;
+			get_weight_band_dims(dim_u, par_const, &dim_band_f, &dim_band_low, &dim_band_chroma);
+			host_arr.weight_f.alloc(dim_band_f);
+			if (dim_band_low.w > 0) { host_arr.weight_low.alloc(dim_band_low); }
+			if (dim_band_chroma.w > 0) { host_arr.weight_chroma.alloc(dim_band_chroma); }
+		}
+		reserve(dim_region, region_par);
+		this->par = par_const;
+		return;
+	}
+	if (par_const.downscale > 1)
+	{
+		const ArrayDim dim_low = upsampling_t::low_dim(dim_u, par_const.downscale);
+		Par par_low = par_const;
+		par_low.downscale = 1;
+		par_low.chroma_downscale = 1;
+		par_low.edges = false;
+		host_arr.guide.alloc(dim_u);
+		host_arr.result.alloc(dim_u);
+		host_arr.low_f.alloc(dim_low);
+		host_arr.low_u.alloc(dim_low);
+		reserve(dim_low, par_low);
+		this->par = par_const;
+		return;
+	}
+	if (par_const.chroma_downscale > 1 && dim_u.num_channels == 3)
+	{
+		const ArrayDim dim_luma(dim_u.w, dim_u.h, 1);
+		const ArrayDim dim_chroma(dim_u.w, dim_u.h, 2);
+		const ArrayDim dim_low = upsampling_t::low_dim(dim_chroma, par_const.chroma_downscale);
+		Par par_luma = par_const;
+		par_luma.chroma_downscale = 1;
+		par_luma.edges = false;
+		par_luma.incremental = false;
+		Par par_chroma = par_luma;
+		par_chroma.weight = true;
+		host_arr.rgb.alloc(dim_u);
+		host_arr.luma_f.alloc(dim_luma);
+		host_arr.luma_u.alloc(dim_luma);
+		host_arr.chroma_f.alloc(dim_chroma);
+		host_arr.chroma_u.alloc(dim_chroma);
+		host_arr.chroma_low_f.alloc(dim_low);
+		host_arr.chroma_low_u.alloc(dim_low);
+		host_arr.chroma_low_weight.alloc(ArrayDim(dim_low.w, dim_low.h, 1));
+		reserve(dim_luma, par_luma);
+		swap_chroma_arrays();
+		reserve(dim_low, par_chroma);
+		swap_chroma_arrays();
+		this->par = par_const;
+		return;
+	}
+
+	this->par = par_const;
+	alloc(dim_u);
+	engine->image_manager()->alloc(arr.f, dim_u);  // for an input which can not be used directly
+	const bool is_1d = (dim_u.w == 1 || dim_u.h == 1);
+	if (par.batch_1d != Par::batch_1d_none || (par.special_solvers && (is_1d || par.alpha < 0)))
+	{
+		if (!arr.u.is_on_host())
+		{
+			host_arr.u.alloc(dim_u);
+			host_arr.f.alloc(dim_u);
+			if (par.weight) { host_arr.regularizer_weight.alloc(arr.regularizer_weight.dim()); }
+		}
+		if (par.batch_1d == Par::batch_1d_none && !is_1d) { region_fusion.reserve(dim_u); }
+	}
+	if (par.batch_1d != Par::batch_1d_none || (par.special_solvers && is_1d) || par.engine == Par::engine_cpu_admm)
+	{
+		host_arr.lines_f.alloc(lines_1d_dim(dim_u, dim_u.num_channels));
+		host_arr.lines_u.alloc(lines_1d_dim(dim_u, dim_u.num_channels));
+		if (par.weight) { host_arr.lines_weight.alloc(lines_1d_dim(dim_u, 1)); }
+	}
+	if (par.incremental && engine->has_tiles() && engine->image_manager()->is_on_host())
+	{
+		if (host_arr.prev_f.alloc(dim_u) > 0) { prev_f_is_set = false; }
+	}
+}
+
+
+template<typename real>
+RunInfo SolverBase<real>::get_run_info()
+{
+	RunInfo run_info;
+	run_info.converged = (stats.stop_iteration != -1 && !stats.time_budget_exceeded && !stats.cancelled);
+	run_info.iterations = (stats.stop_iteration != -1? stats.stop_iteration + 1 : par.iterations);
+	run_info.time_budget_exceeded = stats.time_budget_exceeded;
+	run_info.cancelled = stats.cancelled;
+	run_info.change = (last_change_iteration >= 0? last_change : real(0));
+	run_info.energy = stats.energy;
+	run_info.time_compute = stats.time_compute;
+	run_info.time = stats.time;
+	return run_info;
+}
+
+
 template<typename real>
 BaseImage* SolverBase<real>::run(const BaseImage *image, const Par &par_const)
 {
-	if (!engine->is_valid()) { BaseImage *out_image = image->new_of_same_type_and_size(); return out_image; }
+	BaseImage *out_image = (par_const.has_roi()? image->new_of_same_type(par_const.result_dim(image->dim())) : image->new_of_same_type_and_size());
+	if (!engine->is_valid()) { return out_image; }
+	run_into(out_image, image, par_const);
+	return out_image;
+}
+
+
+template<typename real>
+void SolverBase<real>::run_into(BaseImage *out_image, const BaseImage *image, const Par &par_const)
+{
+	if (!engine->is_valid()) { return; }
+	if (par_const.has_roi())
+	{
+		run_roi_into(out_image, image, par_const);
+		return;
+	}
+	if (par_const.downscale > 1)
+	{
+		run_downscaled_into(out_image, image, par_const);
+		return;
+	}
+	if (par_const.chroma_downscale > 1 && image->dim().num_channels == 3)
+	{
+		run_luma_chroma_into(out_image, image, par_const);
+		return;
+	}
+	if (out_image->dim() != image->dim() && crop_dim.num_elem() == 0)
+	{
+		std::cerr << "ERROR: SolverBase::run_into(): Output size " << out_image->dim() << " differs from input size " << image->dim() << ", nothing computed" << std::endl;
+		return;
+	}
 	Timer timer_all;
 	timer_all.start();
+	timer_budget.start();
 
 	// allocate (only if not already allocated)
 	this->par = par_const;
@@ -204,32 +1138,389 @@ BaseImage* SolverBase<real>::run(const BaseImage *image, const Par &par_const)
 	init(image);
 
 
+	// compute
+	compute();
+
+
+    // get solution, written directly into out_image
+    engine->image_manager()->copy_from_samekind(arr.aux_result, arr.u);
+    copy_solution_from_aux_result(out_image, pd_vars.regularizer);
+    engine->synchronize();
+    timer_all.end();
+    stats.time = timer_all.get();
+    stats.time_sum += stats.time;
+    if (par.verbose) { print_stats(); }
+}
+
+
+template<typename real>
+void SolverBase<real>::run_roi_into(BaseImage *out_image, const BaseImage *image, const Par &par_const)
+{
+	// solve only the region of interest plus a halo around it, with the parameters of the whole image
+	const ArrayDim dim = image->dim();
+	int roi_x0, roi_y0, roi_w, roi_h;
+	par_const.get_roi(dim, &roi_x0, &roi_y0, &roi_w, &roi_h);
+	ArrayDim dim_roi = par_const.result_dim(dim);
+	if (out_image->dim() != dim_roi)
+	{
+		std::cerr << "ERROR: SolverBase::run_into(): Output size " << out_image->dim() << " differs from region of interest size " << dim_roi << ", nothing computed" << std::endl;
+		return;
+	}
+	if (roi_w == 0 || roi_h == 0) { return; }
+	int x0, y0;
+	ArrayDim dim_region;
+	par_const.get_roi_region(dim, &x0, &y0, &dim_region);
+	RegionImage region(image, x0, y0, dim_region);
+
+	Par region_par = par_const.adapted_to(dim);
+	region_par.roi_w = 0;
+	region_par.roi_h = 0;
+	if (x0 != region_x0 || y0 != region_y0)
+	{
+		// the previous u is of another part of the image
+		u_is_computed = false;
+		chroma_u_is_computed = false;
+		region_x0 = x0;
+		region_y0 = y0;
+	}
+	crop_x0 = roi_x0 - x0;
+	crop_y0 = roi_y0 - y0;
+	crop_dim = dim_roi;
+	weight_sigma = (region_par.weight? get_weight_sigma(image, region_par) : real(0));
+	run_into(out_image, &region, region_par);
+	weight_sigma = real(0);
+	crop_dim = ArrayDim();
+}
+
+
+template<typename real>
+void SolverBase<real>::run_downscaled_into(BaseImage *out_image, const BaseImage *image, const Par &par_const)
+{
+	// solve at 1 / downscale of the resolution, and upsample the solution guided by the full resolution input
+	typedef GuidedUpsampling<image_access_t> upsampling_t;
+	const ArrayDim dim = image->dim();
+	const int factor = par_const.downscale;
+	if (out_image->dim() != dim && crop_dim.num_elem() == 0)
+	{
+		std::cerr << "ERROR: SolverBase::run_into(): Output size " << out_image->dim() << " differs from input size " << dim << ", nothing computed" << std::endl;
+		return;
+	}
+	Timer timer_all;
+	timer_all.start();
+	host_arr.guide.alloc(dim);
+	image->copy_to_layered(host_arr.guide.get_untyped_access());
+	const ArrayDim dim_low = upsampling_t::low_dim(dim, factor);
+	host_arr.low_f.alloc(dim_low);
+	host_arr.low_u.alloc(dim_low);
+	upsampling_t::downsample(host_arr.low_f.get_access(), host_arr.guide.get_access(), factor);
+
+	// the same energy on the coarse grid: lengths shrink by factor, areas by factor^2
+	Par par_full = par_const.adapted_to(dim);
+	Par par_low = par_full;
+	par_low.downscale = 1;
+	par_low.chroma_downscale = 1;  // the coarse solve is already cheap, all channels are solved together
+	par_low.edges = false;
+	par_low.verbose = false;
+	if (par_low.alpha >= 0 && par_low.alpha < realmax<double>()) { par_low.alpha /= double(factor) * double(factor); }
+	if (par_low.lambda >= 0 && par_low.lambda < realmax<double>()) { par_low.lambda /= double(factor); }
+	ArrayDim crop_dim_full = crop_dim;
+	crop_dim = ArrayDim();
+	run_into(&host_arr.low_u, &host_arr.low_f, par_low);
+	crop_dim = crop_dim_full;
+
+	host_arr.result.alloc(dim);
+	image_access_t result = host_arr.result.get_access();
+	upsampling_t::upsample(result, host_arr.low_u.get_access(), host_arr.guide.get_access(), factor, real(par_const.downscale_sigma_range));
+	if (par_const.edges)
+	{
+		par_full.weight = false;
+		pd_vars.init(par_full, result, image_access_t(), image_access_t());
+		add_edges_host(result, pd_vars.regularizer);
+	}
+	if (crop_dim.num_elem() == 0)
+	{
+		out_image->copy_from_layered(result.get_untyped_access());
+	}
+	else
+	{
+		write_cropped(out_image, result);
+	}
+	this->par = par_const;
+	timer_all.end();
+	stats.time = timer_all.get();
+	if (par.verbose) { print_stats(); }
+}
+
+
+template<typename real>
+void SolverBase<real>::run_luma_chroma_into(BaseImage *out_image, const BaseImage *image, const Par &par_const)
+{
+	// luma at full resolution, chroma at 1 / chroma_downscale of it, with the discontinuities of the luma solution as regularizer weight
+	typedef GuidedUpsampling<image_access_t> upsampling_t;
+	typedef LumaChroma<image_access_t> luma_chroma_t;
+	const ArrayDim dim = image->dim();
+	const int factor = par_const.chroma_downscale;
+	if (out_image->dim() != dim && crop_dim.num_elem() == 0)
+	{
+		std::cerr << "ERROR: SolverBase::run_into(): Output size " << out_image->dim() << " differs from input size " << dim << ", nothing computed" << std::endl;
+		return;
+	}
+	Timer timer_all;
+	timer_all.start();
+	const ArrayDim dim_luma(dim.w, dim.h, 1);
+	const ArrayDim dim_chroma(dim.w, dim.h, 2);
+	const ArrayDim dim_low = upsampling_t::low_dim(dim_chroma, factor);
+	host_arr.rgb.alloc(dim);
+	host_arr.luma_f.alloc(dim_luma);
+	host_arr.luma_u.alloc(dim_luma);
+	host_arr.chroma_f.alloc(dim_chroma);
+	host_arr.chroma_u.alloc(dim_chroma);
+	host_arr.chroma_low_f.alloc(dim_low);
+	host_arr.chroma_low_u.alloc(dim_low);
+	host_arr.chroma_low_weight.alloc(ArrayDim(dim_low.w, dim_low.h, 1));
+	image->copy_to_layered(host_arr.rgb.get_untyped_access());
+	luma_chroma_t::from_rgb(host_arr.luma_f.get_access(), host_arr.chroma_f.get_access(), host_arr.rgb.get_access());
+	upsampling_t::downsample(host_arr.chroma_low_f.get_access(), host_arr.chroma_f.get_access(), factor);
+
+	Par par_full = par_const.adapted_to(dim);
+	Par par_luma = par_full;
+	par_luma.chroma_downscale = 1;
+	par_luma.edges = false;
+	par_luma.incremental = false;  // luma and chroma alternate in the solver, there is no previous input to compare with
+	par_luma.verbose = false;
+	Par par_chroma = par_luma;
+	par_chroma.weight = true;
+	if (par_chroma.alpha >= 0 && par_chroma.alpha < realmax<double>()) { par_chroma.alpha /= double(factor) * double(factor); }
+	if (par_chroma.lambda >= 0 && par_chroma.lambda < realmax<double>()) { par_chroma.lambda /= double(factor); }
+	ArrayDim crop_dim_full = crop_dim;
+	crop_dim = ArrayDim();
+	run_into(&host_arr.luma_u, &host_arr.luma_f, par_luma);
+	upsampling_t::downsample(host_arr.chroma_low_weight.get_access(), host_arr.luma_u.get_access(), factor);
+	weight_guide = &host_arr.chroma_low_weight;
+	swap_chroma_arrays();
+	run_into(&host_arr.chroma_low_u, &host_arr.chroma_low_f, par_chroma);
+	swap_chroma_arrays();
+	weight_guide = NULL;
+	crop_dim = crop_dim_full;
+
+	// recombine, into the (no longer needed) copy of the input
+	upsampling_t::upsample(host_arr.chroma_u.get_access(), host_arr.chroma_low_u.get_access(), host_arr.chroma_f.get_access(), factor, real(par_const.downscale_sigma_range));
+	image_access_t result = host_arr.rgb.get_access();
+	luma_chroma_t::to_rgb(result, host_arr.luma_u.get_access(), host_arr.chroma_u.get_access());
+	if (par_const.edges)
+	{
+		par_full.weight = false;
+		pd_vars.init(par_full, result, image_access_t(), image_access_t());
+		add_edges_host(result, pd_vars.regularizer);
+	}
+	if (crop_dim.num_elem() == 0)
+	{
+		out_image->copy_from_layered(result.get_untyped_access());
+	}
+	else
+	{
+		write_cropped(out_image, result);
+	}
+	this->par = par_const;
+	timer_all.end();
+	stats.time = timer_all.get();
+	if (par.verbose) { print_stats(); }
+}
+
+
+template<typename real>
+void SolverBase<real>::swap_chroma_arrays()
+{
+	// the chroma solve has another size than the luma solve, it keeps its own arrays (and previous solution) to avoid reallocations
+	std::swap(arr, chroma_arr);
+	std::swap(u_is_computed, chroma_u_is_computed);
+	host_arr.u.swap(host_arr.chroma_solve_u);
+	host_arr.f.swap(host_arr.chroma_solve_f);
+	host_arr.regularizer_weight.swap(host_arr.chroma_solve_regularizer_weight);
+}
+
+
+template<typename real>
+void SolverBase<real>::add_edges_host(image_access_t image, regularizer_t regularizer)
+{
+	// as Engine::add_edges, for a host array when the engine may run on the device
+	linear_operator_t linear_operator = pd_vars.linear_operator;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel default(none) firstprivate(image, linear_operator, regularizer)
+	{
+#endif
+	const Dim2D &dim2d = image.dim().dim2d();
+	const int u_num_channels = image.dim().num_channels;
+	const int p_num_channels = linear_operator.num_channels_range(u_num_channels);
+	HeapArray<real> p_sh(p_num_channels);
+	const real max_range_norm = linear_operator.maximal_possible_range_norm(u_num_channels);
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp for
+#endif
+	for (int y = 0; y < dim2d.h; y++)
+	{
+		for (int x = 0; x < dim2d.w; x++)
+		{
+			linear_operator.apply(p_sh, image, x, y, dim2d, u_num_channels);
+			real mult = real(1) - regularizer.edge_indicator(p_sh, max_range_norm, x, y, dim2d, p_num_channels);
+			for (int i = 0; i < u_num_channels; i++)
+			{
+				image.get(x, y, i) *= mult;
+			}
+		}
+	}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	}
+#endif
+}
+
+
+template<typename real>
+std::vector<BaseImage*> SolverBase<real>::run(const BaseImage *image, const std::vector<Par> &pars)
+{
+	std::vector<BaseImage*> results;
+	if (!engine->is_valid() || !can_run_lanes(image, pars))
+	{
+		// one parameter set after the other
+		for (size_t k = 0; k < pars.size(); k++) { results.push_back(run(image, pars[k])); }
+		return results;
+	}
+	Timer timer_all;
+	timer_all.start();
+
+	// allocate (only if not already allocated)
+	const int num_lanes = (int)pars.size();
+	this->par = pars[0];
+	stats.dim_u = image->dim();
+	stats.dim_p = linear_operator_t::dim_range(stats.dim_u);
+    stats.mem = alloc(stats.dim_u);
+    stats.mem += lane_arr.alloc(engine, stats.dim_u, stats.dim_p, num_lanes);
+
+
+    // initialize f and the weight once, and the regularizer of each lane
+	init(image);
+	std::vector<regularizer_t> regularizers(num_lanes);
+	for (int k = 0; k < num_lanes; k++)
+	{
+		pd_vars.init(pars[k], f_in, arr.regularizer_weight, image_access_t());
+		regularizers[k] = pd_vars.regularizer;
+	}
+	pd_vars.init(par, f_in, arr.regularizer_weight, image_access_t());
+	engine->set_lanes(lane_arr.u, f_in, num_lanes);
+	engine->set_lanes(lane_arr.ubar, f_in, num_lanes);
+	engine->image_manager()->setzero(lane_arr.p);
+
+
 	// compute
 	engine->timer_start();
     stats.stop_iteration = -1;
-    for (int iteration = 0; iteration < par.iterations; iteration++)
-    {
-    	pd_vars.update_vars();
-    	engine->run_dual_p(arr.p, arr.ubar, pd_vars.linear_operator, pd_vars.regularizer, pd_vars.dt_d);
-    	engine->run_prim_u(arr.u, arr.ubar, arr.p, pd_vars.linear_operator, pd_vars.dataterm, pd_vars.theta_bar, pd_vars.dt_p);
-    	if (is_converged(iteration)) { stats.stop_iteration = iteration; break; }
-    }
+    std::vector<real> energies;
+    run_lanes(regularizers, energies);
     engine->timer_end();
-    u_is_computed = true;
+    u_is_computed = false;
     stats.time_compute = engine->timer_get();
     stats.time_compute_sum += stats.time_compute;
     stats.num_runs++;
-    stats.energy = energy();
 
 
-    // get solution
-    BaseImage *result = get_solution(image);
+    // get solutions
+    for (int k = 0; k < num_lanes; k++)
+    {
+    	this->par = pars[k];
+    	engine->get_lane(arr.aux_result, lane_arr.u, num_lanes, k);
+    	results.push_back(get_solution_from_aux_result(image, regularizers[k]));
+    }
     engine->synchronize();
     timer_all.end();
     stats.time = timer_all.get();
     stats.time_sum += stats.time;
-    if (par.verbose) { print_stats(); }
-    return result;
+    for (int k = 0; k < num_lanes; k++)
+    {
+    	this->par = pars[k];
+    	if (!par.verbose) { continue; }
+    	pd_vars.regularizer = regularizers[k];
+    	stats.energy = energies[k];
+    	print_stats();
+    	stats.mem = 0;
+    }
+    return results;
+}
+
+
+template<typename real>
+std::vector<BaseImage*> SolverBase<real>::run_sweep(const BaseImage *image, const std::vector<Par> &pars, std::vector<RunInfo> *run_infos)
+{
+	const int num_points = (int)pars.size();
+	std::vector<BaseImage*> results(num_points, (BaseImage*)NULL);
+	if (run_infos) { run_infos->assign(num_points, RunInfo()); }
+	if (num_points == 0) { return results; }
+	if (!engine->is_valid() || !can_run_sweep(image, pars))
+	{
+		// cold start for every point
+		for (int k = 0; k < num_points; k++)
+		{
+			results[k] = run(image, pars[k]);
+			if (run_infos) { (*run_infos)[k] = get_run_info(); }
+		}
+		return results;
+	}
+
+	// continuation from small to large lambda (lambda < 0 = infinity last), then from small to large alpha
+	std::vector<int> order(num_points);
+	for (int k = 0; k < num_points; k++) { order[k] = k; }
+	std::sort(order.begin(), order.end(), SweepOrder(pars));
+
+	// allocate and initialize once, f and the weight are the same for all points
+	this->par = pars[order[0]];
+	stats.dim_u = image->dim();
+	stats.dim_p = linear_operator_t::dim_range(stats.dim_u);
+    stats.mem = alloc(stats.dim_u);
+	init(image);
+
+	for (int j = 0; j < num_points; j++)
+	{
+		Timer timer_all;
+		timer_all.start();
+		timer_budget.start();
+		const int k = order[j];
+		this->par = pars[k];
+		if (j > 0)
+		{
+			// warm start from the previous u and p, with the step sizes of a new run
+			pd_vars.init(par, f_in, arr.regularizer_weight, image_access_t());
+			engine->image_manager()->copy_from_samekind(arr.ubar, arr.u);
+		}
+		compute();
+		results[k] = get_solution(image);
+		engine->synchronize();
+		timer_all.end();
+		stats.time = timer_all.get();
+		stats.time_sum += stats.time;
+		if (par.verbose) { print_stats(); }
+		if (run_infos) { (*run_infos)[k] = get_run_info(); }
+		stats.mem = 0;
+	}
+	u_is_computed = false;
+	return results;
+}
+
+
+template<typename real>
+bool SolverBase<real>::can_run_sweep(const BaseImage *image, const std::vector<Par> &pars)
+{
+	// the points share f and the weight, and the continuation needs the primal-dual variables
+	const ArrayDim &dim = image->dim();
+	const Par &par0 = pars[0];
+	for (size_t k = 0; k < pars.size(); k++)
+	{
+		const Par &par_k = pars[k];
+		if (par_k.temporal != 0.0 || par_k.weight != par0.weight || par_k.adapt_params != par0.adapt_params || par_k.engine != par0.engine || par_k.use_double != par0.use_double) { return false; }
+
+		// parameter sets solved by other solvers
+		if (par_k.engine == Par::engine_cpu_admm || par_k.batch_1d != Par::batch_1d_none || par_k.incremental || par_k.has_roi() || par_k.downscale > 1 || par_k.chroma_downscale > 1) { return false; }
+		if (par_k.special_solvers && (par_k.alpha < 0 || dim.w == 1 || dim.h == 1)) { return false; }
+	}
+	return true;
 }
 
 
@@ -21,7 +21,11 @@
 #define SOLVER_BASE_H
 
 #include "solver_common_operators.h"
+#include "solver_region_fusion.h"
+#include "solver_1d.h"
 #include "util/image.h"
+#include "util/timer.h"
+#include <vector>
 
 
 
@@ -55,6 +59,23 @@ public:
 	virtual void set_regularizer_weight_from__normgrad(image_access_t regularizer_weight, image_access_t image, linear_operator_t linear_operator) = 0;
 	virtual void set_regularizer_weight_from__exp(image_access_t regularizer_weight, real coeff) = 0;
 	virtual void diff_l1_base(image_access_t a, image_access_t b, image_access_t aux_reduce) = 0;
+
+	// Kernels for solving with several parameter sets at once. The lanes of u and p are interleaved along x,
+	// see LaneAccess, and aux_reduce gets the result of lane k in channel k. Engines without them return false in has_lanes().
+	virtual bool has_lanes() { return false; }
+	virtual void set_lanes(image_access_t u_lanes, image_access_t u, int num_lanes) {}
+	virtual void get_lane(image_access_t u, image_access_t u_lanes, int num_lanes, int lane) {}
+	virtual void run_dual_p_lanes(image_access_t p, image_access_t u, linear_operator_t linear_operator, regularizer_t *regularizers, int num_lanes, real dt) {}
+	virtual void run_prim_u_lanes(image_access_t u, image_access_t ubar, image_access_t p, linear_operator_t linear_operator, dataterm_t dataterm, int num_lanes, real theta_bar, real dt) {}
+	virtual void energy_base_lanes(image_access_t u, image_access_t aux_reduce, linear_operator_t linear_operator, dataterm_t dataterm, regularizer_t *regularizers, int num_lanes) {}
+	virtual void diff_l1_base_lanes(image_access_t a, image_access_t b, image_access_t aux_reduce, int num_lanes) {}
+
+	// Kernels which process only the given square tiles of size tile_size x tile_size, tile t covering the pixels
+	// x in [tile_size * (t % num_tiles_x), ...), y in [tile_size * (t / num_tiles_x), ...). Engines without them return false in has_tiles().
+	virtual bool has_tiles() { return false; }
+	virtual void run_dual_p_tiles(image_access_t p, image_access_t u, linear_operator_t linear_operator, regularizer_t regularizer, real dt, const int *tiles, int num_tiles, int tile_size) {}
+	virtual void run_prim_u_tiles(image_access_t u, image_access_t ubar, image_access_t p, linear_operator_t linear_operator, dataterm_t dataterm, real theta_bar, real dt, const int *tiles, int num_tiles, int tile_size) {}
+	virtual real diff_l1_tiles(image_access_t a, image_access_t b, const int *tiles, int num_tiles, int tile_size) { return real(0); }
 };
 
 
@@ -66,28 +87,151 @@ public:
 	virtual ~SolverBase();
 
 	BaseImage* run(const BaseImage *image, const Par &par_const);
+	void run_into(BaseImage *out_image, const BaseImage *image, const Par &par_const);
+	std::vector<BaseImage*> run(const BaseImage *image, const std::vector<Par> &pars);
+	std::vector<BaseImage*> run_sweep(const BaseImage *image, const std::vector<Par> &pars, std::vector<RunInfo> *run_infos);
+	RunInfo get_run_info();
+	size_t estimate_memory(const ArrayDim &dim_u, const Par &par);
+	void reserve(const ArrayDim &dim_u, const Par &par_const);
 
 protected:
 	void set_engine(Engine<real> *engine);
+	void free();
 
 private:
 	typedef typename Engine<real>::image_access_t image_access_t;
 	typedef typename Engine<real>::linear_operator_t linear_operator_t;
+	typedef typename Engine<real>::regularizer_t regularizer_t;
+	typedef ManagedImage<real, typename Engine<real>::data_interpretation_t> host_image_t;
 
 	size_t alloc(const ArrayDim &dim_u);
-	void free();
 	void init(const BaseImage *image);
-	void set_regularizer_weight_from(image_access_t image);
+	void set_regularizer_weight_from(image_access_t image, real sigma);
+	real get_weight_sigma(const BaseImage *image, const Par &par);
+	static void get_weight_band_dims(const ArrayDim &dim, const Par &par, ArrayDim *dim_f, ArrayDim *dim_low, ArrayDim *dim_chroma);
+	static image_access_t get_band(host_image_t &band_array, const ArrayDim &dim);
 	real energy();
 	real diff_l1(image_access_t a, image_access_t b);
 	bool is_converged(int iteration);
+	void start_loop_checks();
+	bool is_time_budget_over(int iteration);
+	bool is_cancelled(int iteration);
+	void compute();
+	bool can_run_sweep(const BaseImage *image, const std::vector<Par> &pars);
+	bool init_incremental();
+	void reset_changed_tiles();
+	void run_incremental();
+	bool run_special_solver();
+	real run_solver_1d(image_access_t u, image_access_t f, image_access_t regularizer_weight, bool along_x, real alpha, real lambda,
+			image_access_t coupling = image_access_t(), image_access_t coupling_dual = image_access_t(), real coupling_dual_sign = real(0), real mu = real(0));
+	static size_t host_image_size(const ArrayDim &dim);
+	static ArrayDim lines_1d_dim(const ArrayDim &dim, int num_channels);
+	void run_admm();
+	image_access_t to_host(image_access_t a, host_image_t &host_image, bool copy_data);
+	void from_host(image_access_t a, image_access_t a_host);
+	bool can_run_lanes(const BaseImage *image, const std::vector<Par> &pars);
+	void run_lanes(std::vector<regularizer_t> &regularizers, std::vector<real> &energies);
+	image_access_t get_channel(image_access_t a, int i);
 	void print_stats();
 	BaseImage* get_solution(const BaseImage *image);
+	BaseImage* get_solution_from_aux_result(const BaseImage *image, regularizer_t regularizer);
+	void copy_solution_from_aux_result(BaseImage *out_image, regularizer_t regularizer);
+	void run_roi_into(BaseImage *out_image, const BaseImage *image, const Par &par_const);
+	void run_downscaled_into(BaseImage *out_image, const BaseImage *image, const Par &par_const);
+	void run_luma_chroma_into(BaseImage *out_image, const BaseImage *image, const Par &par_const);
+	void swap_chroma_arrays();
+	void add_edges_host(image_access_t image, regularizer_t regularizer);
+	void write_cropped(BaseImage *out_image, image_access_t result);
+
+	struct SweepOrder
+	{
+		SweepOrder(const std::vector<Par> &pars) : pars(pars) {}
+		bool operator() (int a, int b) const
+		{
+			double lambda_a = (pars[a].lambda < 0? realmax<double>() : pars[a].lambda);
+			double lambda_b = (pars[b].lambda < 0? realmax<double>() : pars[b].lambda);
+			if (lambda_a != lambda_b) { return lambda_a < lambda_b; }
+			double alpha_a = (pars[a].alpha < 0? realmax<double>() : pars[a].alpha);
+			double alpha_b = (pars[b].alpha < 0? realmax<double>() : pars[b].alpha);
+			return alpha_a < alpha_b;
+		}
+		const std::vector<Par> &pars;
+	};
 
 	Engine<real> *engine;
 	Par par;
 	PrimalDualVars<image_access_t> pd_vars;
 	bool u_is_computed;
+	RegionFusion<image_access_t> region_fusion;
+	std::vector<ExactSolver1D<real> > solvers_1d;  // one per thread
+	real energy_batch_1d;
+
+	// incremental mode: only the tiles in which f has changed since the previous run, plus a halo of one tile, are iterated
+	static const int incremental_tile_size = 32;
+	bool incremental_run;
+	bool prev_f_is_set;
+	Par prev_f_par;
+	std::vector<char> tile_is_changed;
+	std::vector<int> incremental_tiles;
+
+	// time budget: measured from the start of a run, checked at iterations planned from the measured cost per iteration
+	Timer timer_budget;
+	double time_budget_loop_start;
+	int time_budget_next_check;
+
+	// last computed value of the stopping criterion, for the progress callback
+	real last_change;
+	int last_change_iteration;
+
+	// the input f of the current run: the caller's data if it has the layout, elem type and memory side of the solver arrays, otherwise a copy in arr.f
+	image_access_t f_in;
+
+	// host copies of the arrays for the solvers which run on the host only
+	struct HostArrays
+	{
+		host_image_t u;
+		host_image_t f;
+		host_image_t regularizer_weight;
+		host_image_t lines_f;  // the 1d problems of run_solver_1d, one row per thread
+		host_image_t lines_u;
+		host_image_t lines_weight;
+		host_image_t prev_f;
+		host_image_t roi;
+		host_image_t guide;
+		host_image_t low_f;
+		host_image_t low_u;
+		host_image_t result;
+		host_image_t rgb;
+		host_image_t luma_f;
+		host_image_t luma_u;
+		host_image_t chroma_f;
+		host_image_t chroma_u;
+		host_image_t chroma_low_f;
+		host_image_t chroma_low_u;
+		host_image_t chroma_low_weight;
+		host_image_t chroma_solve_u;
+		host_image_t chroma_solve_f;
+		host_image_t chroma_solve_regularizer_weight;
+		host_image_t weight_f;
+		host_image_t weight_low;
+		host_image_t weight_chroma;
+	} host_arr;
+
+	// region of interest: the result is cropped to crop_dim at (crop_x0, crop_y0), no cropping if crop_dim is empty
+	int crop_x0;
+	int crop_y0;
+	ArrayDim crop_dim;
+
+	// region of interest: position of the solved region (with halo) in the previous run, the previous u is only used at the same position
+	int region_x0;
+	int region_y0;
+
+	// region of interest with weight = true: if > 0, the sigma of the regularizer weight, computed from the whole image
+	real weight_sigma;
+	static const int weight_band_size = 64;  // rows per band of get_weight_sigma()
+
+	// if set: the regularizer weight is computed from this image instead of from f (with par.weight)
+	const BaseImage *weight_guide;
 
 	struct Arrays
 	{
@@ -97,7 +241,6 @@ private:
 			size_t mem = 0;
 			mem += engine->image_manager()->alloc(u, dim_u);
 			mem += engine->image_manager()->alloc(ubar, dim_u);
-			mem += engine->image_manager()->alloc(f, dim_u);
 			mem += engine->image_manager()->alloc(p, dim_p);
 			mem += engine->image_manager()->alloc(regularizer_weight, dim_scalar);
 			mem += engine->image_manager()->alloc(prev_u, dim_u);
@@ -118,7 +261,7 @@ private:
 		}
 		image_access_t u;
 		image_access_t ubar;
-		image_access_t f;
+		image_access_t f;  // allocated by init() only if the input can not be used directly
 		image_access_t p;
 		image_access_t regularizer_weight;
 		image_access_t prev_u;
@@ -126,6 +269,38 @@ private:
 		image_access_t aux_reduce;
 	} arr;
 
+	// the arrays of the chroma solve with chroma_downscale, swapped with arr during it
+	Arrays chroma_arr;
+	bool chroma_u_is_computed;
+
+	// the arrays for several parameter sets, with interleaved lanes
+	struct LaneArrays
+	{
+		size_t alloc(Engine<real> *engine, const ArrayDim &dim_u, const ArrayDim &dim_p, int num_lanes)
+		{
+			ArrayDim dim_u_lanes(dim_u.w * num_lanes, dim_u.h, dim_u.num_channels);
+			ArrayDim dim_p_lanes(dim_p.w * num_lanes, dim_p.h, dim_p.num_channels);
+			ArrayDim dim_reduce_lanes(dim_u.w, dim_u.h, num_lanes);
+			size_t mem = 0;
+			mem += engine->image_manager()->alloc(u, dim_u_lanes);
+			mem += engine->image_manager()->alloc(ubar, dim_u_lanes);
+			mem += engine->image_manager()->alloc(p, dim_p_lanes);
+			mem += engine->image_manager()->alloc(aux_reduce, dim_reduce_lanes);
+			return mem;
+		}
+		void free(Engine<real> *engine)
+		{
+			engine->image_manager()->free(u);
+			engine->image_manager()->free(ubar);
+			engine->image_manager()->free(p);
+			engine->image_manager()->free(aux_reduce);
+		}
+		image_access_t u;
+		image_access_t ubar;
+		image_access_t p;
+		image_access_t aux_reduce;
+	} lane_arr;
+
 	struct ResultStats
 	{
 		ResultStats()
@@ -138,6 +313,10 @@ private:
 			time_sum = 0.0;
 			num_runs = 0;
 			energy = real(0);
+			num_tiles = 0;
+			num_tiles_active = 0;
+			time_budget_exceeded = false;
+			cancelled = false;
 		}
 		ArrayDim dim_u;
 		ArrayDim dim_p;
@@ -149,6 +328,10 @@ private:
 		double time_sum;          // accumulation for averaging
 		int num_runs;
 		real energy;
+		int num_tiles;            // incremental mode: number of all tiles, or 0 for a full solve
+		int num_tiles_active;     // incremental mode: number of iterated tiles
+		bool time_budget_exceeded;
+		bool cancelled;
 	} stats;
 };
 
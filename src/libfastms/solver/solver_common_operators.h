@@ -94,6 +94,30 @@ public:
 };
 
 
+// Access to one lane of an image which stores several images of the same size interleaved along x:
+// (x, y, i) of lane k is at (x * num_lanes + k, y, i) of the underlying image.
+template<typename TImageAccess>
+class LaneAccess
+{
+public:
+	typedef typename TImageAccess::elem_t real;
+
+	HOST_DEVICE LaneAccess(TImageAccess image, int num_lanes, int lane) : image(image), num_lanes(num_lanes), lane(lane)
+	{
+	}
+
+	HOST_DEVICE real& get(int x, int y, int i)
+	{
+		return image.get(x * num_lanes + lane, y, i);
+	}
+
+private:
+	TImageAccess image;
+	int num_lanes;
+	int lane;
+};
+
+
 // Quadratic data term (u - f) ^ 2
 template<typename TImageAccess>
 class Dataterm
@@ -116,18 +140,21 @@ public:
     	return prev_u.is_valid() && (temporal > real(0) || temporal < real(0));
     }
 
+	// arg min_u  (u - u0)^2 / (2 * dt)  +  coeff * (u - f0)^2
+	HOST_DEVICE real prox_quadratic(real u0, real f0, real dt)
+	{
+		real c0 = get_coeff();
+		return f0 + (u0 - f0) / (real(1) + real(2) * dt * c0);
+	}
+
 	template<typename Array1D>
 	HOST_DEVICE void prox (Array1D &u, real dt, int x, int y, const Dim2D &dim2d, const int u_num_channels)
 	{
-		// arg min_u  (u - u0)^2 / (2 * dt)  +  coeff * (u - f)^2
 		real c0 = get_coeff();
 
 		for(int i = 0; i < u_num_channels; i++)
 		{
-			real f0 = f.get(x, y, i);
-			real u0 = u.get(i);
-			u0 = f0 + (u0 - f0) / (real(1) + real(2) * dt * c0);
-			u.get(i) = u0;
+			u.get(i) = prox_quadratic(u.get(i), f.get(x, y, i), dt);
 		}
 
 		if (has_temporal())
@@ -207,12 +234,18 @@ public:
 	HOST_DEVICE void prox_star(Array1D &p, real dt, int x, int y, const Dim2D &dim2d, const int p_num_channels)
 	{
 		real weight0 = (weight.is_valid()? weight.get(x, y, 0) : real(1));
-		// min(alpha * |g|^2, lambda * weight)
 		real nrm2 = vec_norm_squared(p, p_num_channels);
+		real mult = prox_star_mult(nrm2, dt, weight0);
+    	vec_scale_eq (p, p_num_channels, mult);
+	}
+
+	// the factor by which prox_star scales p, given |p|^2
+	HOST_DEVICE real prox_star_mult(real nrm2, real dt, real weight0)
+	{
+		// min(alpha * |g|^2, lambda * weight)
 		real A = (alpha >= 0 && alpha < realmax<real>()? real(2) * alpha / (dt + real(2) * alpha) : real(1));
 		real L = (lambda >= 0 && lambda < realmax<real>()? real(2) * dt * lambda * weight0 : realmax<real>());
-		real mult = (nrm2 * A <= L? A : real(0));
-    	vec_scale_eq (p, p_num_channels, mult);
+		return (nrm2 * A <= L? A : real(0));
 	}
 
 	template<typename Array1D>
@@ -294,7 +327,15 @@ public:
 	    gamma_dataterm = real(2);
 	    if (par.adapt_params)
 	    {
-	    	if (f.dim().h > 1)
+	    	if (par.batch_1d == Par::batch_1d_rows)
+	    	{
+	    		scale_omega = real(f.dim().w) / real(640);
+	    	}
+	    	else if (par.batch_1d == Par::batch_1d_columns)
+	    	{
+	    		scale_omega = real(f.dim().h) / real(640);
+	    	}
+	    	else if (f.dim().h > 1)
 	    	{
 			    scale_omega = realsqrt(real(f.dim().w) * real(f.dim().h)) / realsqrt(real(640) * real(480));
 	    	}
@@ -370,6 +370,7 @@ class SolverDeviceImplementation: public SolverBase<real>
 {
 public:
 	SolverDeviceImplementation() { SolverBase<real>::set_engine(&engine);	}
+	~SolverDeviceImplementation() { SolverBase<real>::free(); }  // while the engine still exists, returns the arrays to the MemPool
 private:
 	DeviceEngine<real> engine;
 };
@@ -378,6 +379,12 @@ private:
 template<typename real> SolverDevice<real>::SolverDevice() : implementation(NULL) { implementation = new SolverDeviceImplementation<real>(); }
 template<typename real> SolverDevice<real>::~SolverDevice() { delete implementation; }
 template<typename real> BaseImage* SolverDevice<real>::run(const BaseImage *image, const Par &par) { return implementation->run(image, par); }
+template<typename real> void SolverDevice<real>::run_into(BaseImage *out_image, const BaseImage *image, const Par &par) { implementation->run_into(out_image, image, par); }
+template<typename real> std::vector<BaseImage*> SolverDevice<real>::run(const BaseImage *image, const std::vector<Par> &pars) { return implementation->run(image, pars); }
+template<typename real> std::vector<BaseImage*> SolverDevice<real>::run_sweep(const BaseImage *image, const std::vector<Par> &pars, std::vector<RunInfo> *run_infos) { return implementation->run_sweep(image, pars, run_infos); }
+template<typename real> RunInfo SolverDevice<real>::get_run_info() { return implementation->get_run_info(); }
+template<typename real> size_t SolverDevice<real>::estimate_memory(const ArrayDim &dim, const Par &par) { return implementation->estimate_memory(dim, par); }
+template<typename real> void SolverDevice<real>::reserve(const ArrayDim &dim, const Par &par) { implementation->reserve(dim, par); }
 template class SolverDevice<float>;
 template class SolverDevice<double>;
 
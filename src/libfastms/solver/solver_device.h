@@ -38,6 +38,12 @@ public:
 	~SolverDevice();
 
 	BaseImage* run(const BaseImage *image, const Par &par);
+	void run_into(BaseImage *out_image, const BaseImage *image, const Par &par);
+	std::vector<BaseImage*> run(const BaseImage *image, const std::vector<Par> &pars);
+	std::vector<BaseImage*> run_sweep(const BaseImage *image, const std::vector<Par> &pars, std::vector<RunInfo> *run_infos);
+	RunInfo get_run_info();
+	size_t estimate_memory(const ArrayDim &dim, const Par &par);
+	void reserve(const ArrayDim &dim, const Par &par);
 
 private:
 	SolverDevice(const SolverDevice<real> &other_solver);  // disable
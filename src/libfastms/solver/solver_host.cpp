@@ -22,6 +22,7 @@
 #include "util/mem.h"
 #include "util/sum.h"
 #include "util/timer.h"
+#include <algorithm>  // for std::min
 
 
 
@@ -34,7 +35,7 @@ public:
 	typedef typename Base::linear_operator_t linear_operator_t;
 	typedef typename Base::regularizer_t regularizer_t;
 	typedef typename Base::dataterm_t dataterm_t;
-	typedef HostAllocator allocator_t;
+	typedef HostPoolAllocator allocator_t;
 	typedef ImageManager<real, typename image_access_t::data_interpretation_t, allocator_t> image_manager_t;
 
 	HostEngine() {}
@@ -58,6 +59,25 @@ public:
 	virtual void set_regularizer_weight_from__exp(image_access_t regularizer_weight, real coeff);
 	virtual void diff_l1_base(image_access_t a, image_access_t b, image_access_t aux_reduce);
 
+	// many channels (hyperspectral): row kernels over blocks of pixels, see run_dual_p_rows()
+	static const int many_channels_min = 8;
+	static const int many_channels_block = 256;
+	void run_dual_p_rows(image_access_t p, image_access_t u, regularizer_t regularizer, real dt);
+	void run_prim_u_rows(image_access_t u, image_access_t ubar, image_access_t p, dataterm_t dataterm, real theta_bar, real dt);
+
+	virtual bool has_lanes() { return true; }
+	virtual void set_lanes(image_access_t u_lanes, image_access_t u, int num_lanes);
+	virtual void get_lane(image_access_t u, image_access_t u_lanes, int num_lanes, int lane);
+	virtual void run_dual_p_lanes(image_access_t p, image_access_t u, linear_operator_t linear_operator, regularizer_t *regularizers, int num_lanes, real dt);
+	virtual void run_prim_u_lanes(image_access_t u, image_access_t ubar, image_access_t p, linear_operator_t linear_operator, dataterm_t dataterm, int num_lanes, real theta_bar, real dt);
+	virtual void energy_base_lanes(image_access_t u, image_access_t aux_reduce, linear_operator_t linear_operator, dataterm_t dataterm, regularizer_t *regularizers, int num_lanes);
+	virtual void diff_l1_base_lanes(image_access_t a, image_access_t b, image_access_t aux_reduce, int num_lanes);
+
+	virtual bool has_tiles() { return true; }
+	virtual void run_dual_p_tiles(image_access_t p, image_access_t u, linear_operator_t linear_operator, regularizer_t regularizer, real dt, const int *tiles, int num_tiles, int tile_size);
+	virtual void run_prim_u_tiles(image_access_t u, image_access_t ubar, image_access_t p, linear_operator_t linear_operator, dataterm_t dataterm, real theta_bar, real dt, const int *tiles, int num_tiles, int tile_size);
+	virtual real diff_l1_tiles(image_access_t a, image_access_t b, const int *tiles, int num_tiles, int tile_size);
+
 	image_manager_t image_manager_;
 	Timer timer;
 };
@@ -74,9 +94,57 @@ std::string HostEngine<real>::str()
 }
 
 
+template<typename TImageAccess, typename TLinearOperator, typename TRegularizer, typename TArray>
+inline void host_run_dual_p_pixel(TArray &p_sh, TImageAccess p, TImageAccess u, TLinearOperator &linear_operator, TRegularizer &regularizer, typename TImageAccess::elem_t dt,
+		int x, int y, const Dim2D &dim2d, const int u_num_channels, const int p_num_channels)
+{
+	linear_operator.apply(p_sh, u, x, y, dim2d, u_num_channels);
+
+	for(int i = 0; i < p_num_channels; i++)
+	{
+		p_sh.get(i) = p.get(x, y, i) + p_sh.get(i) * dt;
+	}
+
+	regularizer.prox_star(p_sh, dt, x, y, dim2d, p_num_channels);
+
+	for(int i = 0; i < p_num_channels; i++)
+	{
+		p.get(x, y, i) = p_sh.get(i);
+	}
+}
+
+
+template<typename TImageAccess, typename TLinearOperator, typename TDataterm, typename TArray>
+inline void host_run_prim_u_pixel(TArray &u_sh, TArray &valold_sh, TImageAccess u, TImageAccess ubar, TImageAccess p, TLinearOperator &linear_operator, TDataterm &dataterm,
+		typename TImageAccess::elem_t theta_bar, typename TImageAccess::elem_t dt, int x, int y, const Dim2D &dim2d, const int u_num_channels)
+{
+	typedef typename TImageAccess::elem_t real;
+
+	linear_operator.apply_transpose(u_sh, p, x, y, dim2d, u_num_channels);
+
+	for(int i = 0; i < u_num_channels; i++)
+	{
+		real valold = u.get(x, y, i);
+		u_sh.get(i) = valold - u_sh.get(i) * dt;
+		valold_sh.get(i) = valold;
+	}
+
+	dataterm.prox(u_sh, dt, x, y, dim2d, u_num_channels);
+
+	for(int i = 0; i < u_num_channels; i++)
+	{
+		real valnew = u_sh.get(i);
+		u.get(x, y, i) = valnew;
+		real valold = valold_sh.get(i);
+		ubar.get(x, y, i) = valnew + (valnew - valold) * theta_bar;
+	}
+}
+
+
 template<typename real>
 void HostEngine<real>::run_dual_p(image_access_t p, image_access_t u, linear_operator_t linear_operator, regularizer_t regularizer, real dt)
 {
+	if (u.dim().num_channels >= many_channels_min) { run_dual_p_rows(p, u, regularizer, dt); return; }
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
     #pragma omp parallel default(none) firstprivate(p, u, linear_operator, regularizer, dt)
 	{
@@ -92,19 +160,7 @@ void HostEngine<real>::run_dual_p(image_access_t p, image_access_t u, linear_ope
 	{
 		for (int x = 0; x < dim2d.w; x++)
 		{
-			linear_operator.apply(p_sh, u, x, y, dim2d, u_num_channels);
-
-			for(int i = 0; i < p_num_channels; i++)
-			{
-				p_sh.get(i) = p.get(x, y, i) + p_sh.get(i) * dt;
-			}
-
-			regularizer.prox_star(p_sh, dt, x, y, dim2d, p_num_channels);
-
-			for(int i = 0; i < p_num_channels; i++)
-			{
-				p.get(x, y, i) = p_sh.get(i);
-			}
+			host_run_dual_p_pixel(p_sh, p, u, linear_operator, regularizer, dt, x, y, dim2d, u_num_channels, p_num_channels);
 		}
 	}
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
@@ -116,6 +172,7 @@ void HostEngine<real>::run_dual_p(image_access_t p, image_access_t u, linear_ope
 template<typename real>
 void HostEngine<real>::run_prim_u(image_access_t u, image_access_t ubar, image_access_t p, linear_operator_t linear_operator, dataterm_t dataterm, real theta_bar, real dt)
 {
+	if (u.dim().num_channels >= many_channels_min && !dataterm.has_temporal()) { run_prim_u_rows(u, ubar, p, dataterm, theta_bar, dt); return; }
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
     #pragma omp parallel default(none) firstprivate(u, ubar, p, linear_operator, dataterm, theta_bar, dt)
 	{
@@ -131,23 +188,63 @@ void HostEngine<real>::run_prim_u(image_access_t u, image_access_t ubar, image_a
 	{
 		for (int x = 0; x < dim2d.w; x++)
 		{
-			linear_operator.apply_transpose(u_sh, p, x, y, dim2d, u_num_channels);
+			host_run_prim_u_pixel(u_sh, valold_sh, u, ubar, p, linear_operator, dataterm, theta_bar, dt, x, y, dim2d, u_num_channels);
+		}
+	}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	}
+#endif
+}
 
-			for(int i = 0; i < u_num_channels; i++)
+
+template<typename real>
+void HostEngine<real>::run_dual_p_rows(image_access_t p, image_access_t u, regularizer_t regularizer, real dt)
+{
+	// The same as run_dual_p() with LinearOperator (forward differences), but channel by channel over a block of pixels of a row,
+	// instead of pixel by pixel over all channels: In the layered layout the pixels of a row of one channel are contiguous,
+	// so the inner loops are contiguous and vectorizable, and the norm over the 2 * C channels of a pixel is accumulated per block.
+	// The block is small enough that its p (2 * C * block values) stays in the cache between the update and the scaling.
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel default(none) firstprivate(p, u, regularizer, dt)
+	{
+#endif
+	const Dim2D &dim2d = u.dim().dim2d();
+	const int u_num_channels = u.dim().num_channels;
+	const int block = std::max(16, std::min((int)many_channels_block, 32768 / (2 * u_num_channels)));
+	HeapArray<real> nrm2(block);
+	HeapArray<real> mult(block);
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp for
+#endif
+	for (int y = 0; y < dim2d.h; y++)
+	{
+		for (int x0 = 0; x0 < dim2d.w; x0 += block)
+		{
+			const int n = std::min(block, dim2d.w - x0);
+			const int n_x = std::min(n, dim2d.w - 1 - x0);  // pixels with a right neighbor
+			for (int k = 0; k < n; k++) { nrm2.get(k) = real(0); }
+			for (int i = 0; i < u_num_channels; i++)
 			{
-				real valold = u.get(x, y, i);
-				u_sh.get(i) = valold - u_sh.get(i) * dt;
-				valold_sh.get(i) = valold;
+				const real *u_row = &u.get(x0, y, i);
+				real *px = &p.get(x0, y, 2 * i);
+				real *py = &p.get(x0, y, 2 * i + 1);
+				for (int k = 0; k < n_x; k++) { px[k] += (u_row[k + 1] - u_row[k]) * dt; }
+				if (y + 1 < dim2d.h)
+				{
+					const real *u_next = &u.get(x0, y + 1, i);
+					for (int k = 0; k < n; k++) { py[k] += (u_next[k] - u_row[k]) * dt; }
+				}
+				for (int k = 0; k < n; k++) { nrm2.get(k) += px[k] * px[k] + py[k] * py[k]; }
 			}
-
-			dataterm.prox(u_sh, dt, x, y, dim2d, u_num_channels);
-
-			for(int i = 0; i < u_num_channels; i++)
+			for (int k = 0; k < n; k++)
+			{
+				real weight0 = (regularizer.weight.is_valid()? regularizer.weight.get(x0 + k, y, 0) : real(1));
+				mult.get(k) = regularizer.prox_star_mult(nrm2.get(k), dt, weight0);
+			}
+			for (int i = 0; i < 2 * u_num_channels; i++)
 			{
-				real valnew = u_sh.get(i);
-				u.get(x, y, i) = valnew;
-				real valold = valold_sh.get(i);
-				ubar.get(x, y, i) = valnew + (valnew - valold) * theta_bar;
+				real *p_row = &p.get(x0, y, i);
+				for (int k = 0; k < n; k++) { p_row[k] *= mult.get(k); }
 			}
 		}
 	}
@@ -157,6 +254,42 @@ void HostEngine<real>::run_prim_u(image_access_t u, image_access_t ubar, image_a
 }
 
 
+template<typename real>
+void HostEngine<real>::run_prim_u_rows(image_access_t u, image_access_t ubar, image_access_t p, dataterm_t dataterm, real theta_bar, real dt)
+{
+	// The same as run_prim_u() with LinearOperator, channel by channel over whole rows (see run_dual_p_rows()).
+	// Without the temporal term the data term acts on each channel separately.
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel for default(none) firstprivate(u, ubar, p, dataterm, theta_bar, dt)
+#endif
+	for (int y = 0; y < u.dim().h; y++)
+	{
+		const int w = u.dim().w;
+		const int h = u.dim().h;
+		for (int i = 0; i < u.dim().num_channels; i++)
+		{
+			const real *px = &p.get(0, y, 2 * i);
+			const real *py = &p.get(0, y, 2 * i + 1);
+			const real *py_prev = (y > 0? &p.get(0, y - 1, 2 * i + 1) : NULL);
+			const real *f_row = &dataterm.f.get(0, y, i);
+			real *u_row = &u.get(0, y, i);
+			real *ubar_row = &ubar.get(0, y, i);
+			for (int x = 0; x < w; x++)
+			{
+				real p1_0 = (x + 1 < w? px[x] : real(0));
+				real p1_x = (x > 0? px[x - 1] : real(0));
+				real p2_0 = (y + 1 < h? py[x] : real(0));
+				real p2_y = (py_prev? py_prev[x] : real(0));
+				real valold = u_row[x];
+				real valnew = dataterm.prox_quadratic(valold - (p1_x - p1_0 + p2_y - p2_0) * dt, f_row[x], dt);
+				u_row[x] = valnew;
+				ubar_row[x] = valnew + (valnew - valold) * theta_bar;
+			}
+		}
+	}
+}
+
+
 template<typename real>
 void HostEngine<real>::energy_base(image_access_t u, image_access_t aux_reduce, linear_operator_t linear_operator, dataterm_t dataterm, regularizer_t regularizer)
 {
@@ -317,11 +450,363 @@ void HostEngine<real>::diff_l1_base(image_access_t a, image_access_t b, image_ac
 
 
 
+template<typename real>
+void HostEngine<real>::run_dual_p_tiles(image_access_t p, image_access_t u, linear_operator_t linear_operator, regularizer_t regularizer, real dt, const int *tiles, int num_tiles, int tile_size)
+{
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel default(none) firstprivate(p, u, linear_operator, regularizer, dt, tiles, num_tiles, tile_size)
+	{
+#endif
+	const Dim2D &dim2d = u.dim().dim2d();
+	const int u_num_channels = u.dim().num_channels;
+	const int p_num_channels = linear_operator.num_channels_range(u_num_channels);
+	const int num_tiles_x = (dim2d.w + tile_size - 1) / tile_size;
+	HeapArray<real> p_sh(p_num_channels);
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp for
+#endif
+	for (int k = 0; k < num_tiles; k++)
+	{
+		const int x0 = tile_size * (tiles[k] % num_tiles_x);
+		const int y0 = tile_size * (tiles[k] / num_tiles_x);
+		const int x1 = std::min(x0 + tile_size, dim2d.w);
+		const int y1 = std::min(y0 + tile_size, dim2d.h);
+		for (int y = y0; y < y1; y++)
+		{
+			for (int x = x0; x < x1; x++)
+			{
+				host_run_dual_p_pixel(p_sh, p, u, linear_operator, regularizer, dt, x, y, dim2d, u_num_channels, p_num_channels);
+			}
+		}
+	}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	}
+#endif
+}
+
+
+template<typename real>
+void HostEngine<real>::run_prim_u_tiles(image_access_t u, image_access_t ubar, image_access_t p, linear_operator_t linear_operator, dataterm_t dataterm, real theta_bar, real dt, const int *tiles, int num_tiles, int tile_size)
+{
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel default(none) firstprivate(u, ubar, p, linear_operator, dataterm, theta_bar, dt, tiles, num_tiles, tile_size)
+	{
+#endif
+	const Dim2D &dim2d = u.dim().dim2d();
+	const int u_num_channels = u.dim().num_channels;
+	const int num_tiles_x = (dim2d.w + tile_size - 1) / tile_size;
+	HeapArray<real> u_sh(u_num_channels);
+	HeapArray<real> valold_sh(u_num_channels);
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp for
+#endif
+	for (int k = 0; k < num_tiles; k++)
+	{
+		const int x0 = tile_size * (tiles[k] % num_tiles_x);
+		const int y0 = tile_size * (tiles[k] / num_tiles_x);
+		const int x1 = std::min(x0 + tile_size, dim2d.w);
+		const int y1 = std::min(y0 + tile_size, dim2d.h);
+		for (int y = y0; y < y1; y++)
+		{
+			for (int x = x0; x < x1; x++)
+			{
+				host_run_prim_u_pixel(u_sh, valold_sh, u, ubar, p, linear_operator, dataterm, theta_bar, dt, x, y, dim2d, u_num_channels);
+			}
+		}
+	}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	}
+#endif
+}
+
+
+template<typename real>
+real HostEngine<real>::diff_l1_tiles(image_access_t a, image_access_t b, const int *tiles, int num_tiles, int tile_size)
+{
+	const Dim2D &dim2d = a.dim().dim2d();
+	const int a_num_channels = a.dim().num_channels;
+	const int num_tiles_x = (dim2d.w + tile_size - 1) / tile_size;
+	double diff = 0.0;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel for reduction(+: diff)
+#endif
+	for (int k = 0; k < num_tiles; k++)
+	{
+		const int x0 = tile_size * (tiles[k] % num_tiles_x);
+		const int y0 = tile_size * (tiles[k] / num_tiles_x);
+		const int x1 = std::min(x0 + tile_size, dim2d.w);
+		const int y1 = std::min(y0 + tile_size, dim2d.h);
+		for (int y = y0; y < y1; y++)
+		{
+			for (int x = x0; x < x1; x++)
+			{
+				for (int i = 0; i < a_num_channels; i++)
+				{
+					diff += (double)realabs(a.get(x, y, i) - b.get(x, y, i));
+				}
+			}
+		}
+	}
+	return (real)diff;
+}
+
+
+template<typename real>
+void HostEngine<real>::set_lanes(image_access_t u_lanes, image_access_t u, int num_lanes)
+{
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel default(none) firstprivate(u_lanes, u, num_lanes)
+	{
+#endif
+	const Dim2D &dim2d = u.dim().dim2d();
+	const int u_num_channels = u.dim().num_channels;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp for
+#endif
+	for (int y = 0; y < dim2d.h; y++)
+	{
+		for (int i = 0; i < u_num_channels; i++)
+		{
+			for (int x = 0; x < dim2d.w; x++)
+			{
+				real val = u.get(x, y, i);
+				for (int k = 0; k < num_lanes; k++) { u_lanes.get(x * num_lanes + k, y, i) = val; }
+			}
+		}
+	}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    }
+#endif
+}
+
+
+template<typename real>
+void HostEngine<real>::get_lane(image_access_t u, image_access_t u_lanes, int num_lanes, int lane)
+{
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel default(none) firstprivate(u, u_lanes, num_lanes, lane)
+	{
+#endif
+	const Dim2D &dim2d = u.dim().dim2d();
+	const int u_num_channels = u.dim().num_channels;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp for
+#endif
+	for (int y = 0; y < dim2d.h; y++)
+	{
+		for (int i = 0; i < u_num_channels; i++)
+		{
+			for (int x = 0; x < dim2d.w; x++)
+			{
+				u.get(x, y, i) = u_lanes.get(x * num_lanes + lane, y, i);
+			}
+		}
+	}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    }
+#endif
+}
+
+
+// The lane kernels work on whole rows, with the lanes of one pixel adjacent in memory, so that the innermost loops
+// run over contiguous memory and f and the weight are read once for all lanes. Same stencil as LinearOperator.
+template<typename real>
+void HostEngine<real>::run_dual_p_lanes(image_access_t p, image_access_t u, linear_operator_t linear_operator, regularizer_t *regularizers, int num_lanes, real dt)
+{
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel default(none) firstprivate(p, u, linear_operator, regularizers, num_lanes, dt)
+	{
+#endif
+	const Dim2D dim2d(u.dim().w / num_lanes, u.dim().h);
+	const int w_lanes = u.dim().w;
+	const int u_num_channels = u.dim().num_channels;
+	image_access_t weight = regularizers[0].weight;
+	HeapArray<real> nrm2_sh(w_lanes);
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp for
+#endif
+	for (int y = 0; y < dim2d.h; y++)
+	{
+		for (int t = 0; t < w_lanes; t++) { nrm2_sh.get(t) = real(0); }
+
+		// gradient step
+		for (int i = 0; i < u_num_channels; i++)
+		{
+			const real *u_row = &u.get(0, y, i);
+			const real *u_row_next = (y + 1 < dim2d.h? &u.get(0, y + 1, i) : u_row);
+			real *p_row_x = &p.get(0, y, 2 * i);
+			real *p_row_y = &p.get(0, y, 2 * i + 1);
+			for (int x = 0; x < dim2d.w; x++)
+			{
+				const int x0 = x * num_lanes;
+				const int dx = (x + 1 < dim2d.w? num_lanes : 0);
+				for (int k = 0; k < num_lanes; k++)
+				{
+					real u0 = u_row[x0 + k];
+					real px = p_row_x[x0 + k] + (u_row[x0 + dx + k] - u0) * dt;
+					real py = p_row_y[x0 + k] + (u_row_next[x0 + k] - u0) * dt;
+					p_row_x[x0 + k] = px;
+					p_row_y[x0 + k] = py;
+					nrm2_sh.get(x0 + k) += px * px;
+					nrm2_sh.get(x0 + k) += py * py;
+				}
+			}
+		}
+
+		// prox of the regularizer of each lane
+		for (int x = 0; x < dim2d.w; x++)
+		{
+			real weight0 = (weight.is_valid()? weight.get(x, y, 0) : real(1));
+			for (int k = 0; k < num_lanes; k++)
+			{
+				nrm2_sh.get(x * num_lanes + k) = regularizers[k].prox_star_mult(nrm2_sh.get(x * num_lanes + k), dt, weight0);
+			}
+		}
+		for (int i = 0; i < 2 * u_num_channels; i++)
+		{
+			real *p_row = &p.get(0, y, i);
+			for (int t = 0; t < w_lanes; t++) { p_row[t] *= nrm2_sh.get(t); }
+		}
+	}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	}
+#endif
+}
+
+
+template<typename real>
+void HostEngine<real>::run_prim_u_lanes(image_access_t u, image_access_t ubar, image_access_t p, linear_operator_t linear_operator, dataterm_t dataterm, int num_lanes, real theta_bar, real dt)
+{
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel default(none) firstprivate(u, ubar, p, linear_operator, dataterm, num_lanes, theta_bar, dt)
+	{
+#endif
+	const Dim2D dim2d(u.dim().w / num_lanes, u.dim().h);
+	const int u_num_channels = u.dim().num_channels;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp for
+#endif
+	for (int y = 0; y < dim2d.h; y++)
+	{
+		for (int i = 0; i < u_num_channels; i++)
+		{
+			real *u_row = &u.get(0, y, i);
+			real *ubar_row = &ubar.get(0, y, i);
+			const real *p_row_x = &p.get(0, y, 2 * i);
+			const real *p_row_y = &p.get(0, y, 2 * i + 1);
+			const real *p_row_y_prev = (y > 0? &p.get(0, y - 1, 2 * i + 1) : p_row_y);
+			const real mult_y = (y + 1 < dim2d.h? real(1) : real(0));
+			const real mult_y_prev = (y > 0? real(1) : real(0));
+			for (int x = 0; x < dim2d.w; x++)
+			{
+				const int x0 = x * num_lanes;
+				const real mult_x = (x + 1 < dim2d.w? real(1) : real(0));
+				const int x0_prev = (x > 0? x0 - num_lanes : x0);
+				const real mult_x_prev = (x > 0? real(1) : real(0));
+				const real f0 = dataterm.f.get(x, y, i);
+				for (int k = 0; k < num_lanes; k++)
+				{
+					real div = p_row_x[x0_prev + k] * mult_x_prev - p_row_x[x0 + k] * mult_x + p_row_y_prev[x0 + k] * mult_y_prev - p_row_y[x0 + k] * mult_y;
+					real valold = u_row[x0 + k];
+					real valnew = dataterm.prox_quadratic(valold - div * dt, f0, dt);
+					u_row[x0 + k] = valnew;
+					ubar_row[x0 + k] = valnew + (valnew - valold) * theta_bar;
+				}
+			}
+		}
+	}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	}
+#endif
+}
+
+
+template<typename real>
+void HostEngine<real>::energy_base_lanes(image_access_t u, image_access_t aux_reduce, linear_operator_t linear_operator, dataterm_t dataterm, regularizer_t *regularizers, int num_lanes)
+{
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel default(none) firstprivate(u, aux_reduce, linear_operator, dataterm, regularizers, num_lanes)
+	{
+#endif
+	const Dim2D dim2d(u.dim().w / num_lanes, u.dim().h);
+	const int u_num_channels = u.dim().num_channels;
+	const int p_num_channels = linear_operator.num_channels_range(u_num_channels);
+	HeapArray<real> u_sh(u_num_channels);
+	HeapArray<real> p_sh(p_num_channels);
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp for
+#endif
+	for (int y = 0; y < dim2d.h; y++)
+	{
+		for (int x = 0; x < dim2d.w; x++)
+		{
+			for (int k = 0; k < num_lanes; k++)
+			{
+				LaneAccess<image_access_t> u_k(u, num_lanes, k);
+				real energy = real(0);
+				linear_operator.apply(p_sh, u_k, x, y, dim2d, u_num_channels);
+				energy += regularizers[k].value(p_sh, x, y, dim2d, p_num_channels);
+
+				for(int i = 0; i < u_num_channels; i++)
+				{
+					u_sh.get(i) = u_k.get(x, y, i);
+				}
+				energy += dataterm.value(u_sh, x, y, dim2d, u_num_channels);
+
+				aux_reduce.get(x, y, k) = energy;
+			}
+		}
+	}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    }
+#endif
+}
+
+
+template<typename real>
+void HostEngine<real>::diff_l1_base_lanes(image_access_t a, image_access_t b, image_access_t aux_reduce, int num_lanes)
+{
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel default(none) firstprivate(a, b, aux_reduce, num_lanes)
+	{
+#endif
+	const Dim2D dim2d(a.dim().w / num_lanes, a.dim().h);
+	int a_num_channels = a.dim().num_channels;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp for
+#endif
+	for (int y = 0; y < dim2d.h; y++)
+	{
+		for (int x = 0; x < dim2d.w; x++)
+		{
+			for (int k = 0; k < num_lanes; k++)
+			{
+				int x_k = x * num_lanes + k;
+				real diff = real(0);
+				for (int i = 0; i < a_num_channels; i++)
+				{
+					real val_a = a.get(x_k, y, i);
+					real val_b = b.get(x_k, y, i);
+					diff += realabs(val_a - val_b);
+				}
+				aux_reduce.get(x, y, k) = diff;
+			}
+		}
+	}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    }
+#endif
+}
+
+
+
+
 template<typename real>
 class SolverHostImplementation: public SolverBase<real>
 {
 public:
 	SolverHostImplementation() { SolverBase<real>::set_engine(&engine);	}
+	~SolverHostImplementation() { SolverBase<real>::free(); }  // while the engine still exists, returns the arrays to the MemPool
 private:
 	HostEngine<real> engine;
 };
@@ -330,6 +815,12 @@ private:
 template<typename real> SolverHost<real>::SolverHost() : implementation(NULL) {	implementation = new SolverHostImplementation<real>(); }
 template<typename real> SolverHost<real>::~SolverHost() { delete implementation; }
 template<typename real> BaseImage* SolverHost<real>::run(const BaseImage *image, const Par &par) { return implementation->run(image, par); }
+template<typename real> void SolverHost<real>::run_into(BaseImage *out_image, const BaseImage *image, const Par &par) { implementation->run_into(out_image, image, par); }
+template<typename real> std::vector<BaseImage*> SolverHost<real>::run(const BaseImage *image, const std::vector<Par> &pars) { return implementation->run(image, pars); }
+template<typename real> std::vector<BaseImage*> SolverHost<real>::run_sweep(const BaseImage *image, const std::vector<Par> &pars, std::vector<RunInfo> *run_infos) { return implementation->run_sweep(image, pars, run_infos); }
+template<typename real> RunInfo SolverHost<real>::get_run_info() { return implementation->get_run_info(); }
+template<typename real> size_t SolverHost<real>::estimate_memory(const ArrayDim &dim, const Par &par) { return implementation->estimate_memory(dim, par); }
+template<typename real> void SolverHost<real>::reserve(const ArrayDim &dim, const Par &par) { implementation->reserve(dim, par); }
 
 template class SolverHost<float>;
 template class SolverHost<double>;
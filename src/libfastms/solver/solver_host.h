@@ -35,6 +35,12 @@ public:
 	~SolverHost();
 
 	BaseImage* run(const BaseImage *in_image, const Par &par);
+	void run_into(BaseImage *out_image, const BaseImage *in_image, const Par &par);
+	std::vector<BaseImage*> run(const BaseImage *in_image, const std::vector<Par> &pars);
+	std::vector<BaseImage*> run_sweep(const BaseImage *in_image, const std::vector<Par> &pars, std::vector<RunInfo> *run_infos);
+	RunInfo get_run_info();
+	size_t estimate_memory(const ArrayDim &dim, const Par &par);
+	void reserve(const ArrayDim &dim, const Par &par);
 
 private:
 	SolverHost(const SolverHost<real> &other_solver);  // disable
@@ -0,0 +1,92 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SOLVER_LUMA_CHROMA_H
+#define SOLVER_LUMA_CHROMA_H
+
+#include "util/image_access.h"
+
+
+
+// Conversion between RGB and a luma / chroma space (Y, Cb, Cr of ITU-R BT.601, without offsets), for Par::chroma_downscale.
+//
+//   Y = 0.299 * R + 0.587 * G + 0.114 * B,  Cb = 0.564 * (B - Y),  Cr = 0.713 * (R - Y)
+//
+// Host only, on layered arrays.
+template<typename TImageAccess>
+class LumaChroma
+{
+public:
+	typedef typename TImageAccess::elem_t real;
+
+	// rgb with 3 channels into luma with 1 channel and chroma with 2 channels, all of the same size
+	static void from_rgb(TImageAccess luma, TImageAccess chroma, TImageAccess rgb)
+	{
+		const Dim2D dim2d = rgb.dim().dim2d();
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp parallel for
+#endif
+		for (int y = 0; y < dim2d.h; y++)
+		{
+			const real *r = &rgb.get(0, y, 0);
+			const real *g = &rgb.get(0, y, 1);
+			const real *b = &rgb.get(0, y, 2);
+			real *l = &luma.get(0, y, 0);
+			real *cb = &chroma.get(0, y, 0);
+			real *cr = &chroma.get(0, y, 1);
+			for (int x = 0; x < dim2d.w; x++)
+			{
+				real val_l = real(0.299) * r[x] + real(0.587) * g[x] + real(0.114) * b[x];
+				l[x] = val_l;
+				cb[x] = real(0.564) * (b[x] - val_l);
+				cr[x] = real(0.713) * (r[x] - val_l);
+			}
+		}
+	}
+
+	static void to_rgb(TImageAccess rgb, TImageAccess luma, TImageAccess chroma)
+	{
+		const Dim2D dim2d = rgb.dim().dim2d();
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp parallel for
+#endif
+		for (int y = 0; y < dim2d.h; y++)
+		{
+			real *r = &rgb.get(0, y, 0);
+			real *g = &rgb.get(0, y, 1);
+			real *b = &rgb.get(0, y, 2);
+			const real *l = &luma.get(0, y, 0);
+			const real *cb = &chroma.get(0, y, 0);
+			const real *cr = &chroma.get(0, y, 1);
+			for (int x = 0; x < dim2d.w; x++)
+			{
+				real val_r = l[x] + cr[x] / real(0.713);
+				real val_b = l[x] + cb[x] / real(0.564);
+				r[x] = val_r;
+				b[x] = val_b;
+				g[x] = (l[x] - real(0.299) * val_r - real(0.114) * val_b) / real(0.587);
+			}
+		}
+	}
+};
+
+
+
+#endif // SOLVER_LUMA_CHROMA_H
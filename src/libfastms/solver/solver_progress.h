@@ -0,0 +1,71 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SOLVER_PROGRESS_H
+#define SOLVER_PROGRESS_H
+
+#include <cstddef>
+
+
+
+// Information passed to the progress callback, see Par::progress_callback and Par3::progress_callback
+struct ProgressInfo
+{
+	ProgressInfo()
+	{
+		iteration = 0;
+		change = 0.0;
+		u = NULL;
+		u_is_double = false;
+		u_is_on_host = true;
+		u_pitch = 0;
+		w = 0;
+		h = 0;
+		d = 1;
+		num_channels = 0;
+	}
+
+	// Number of performed iterations.
+	int iteration;
+
+	// Current value of the convergence measure, which is compared with stop_eps:
+	// the average per-pixel change of the solution in the last iteration.
+	double change;
+
+	// Read-only view of the current solution, valid only during the callback.
+	// Element (x, y, z, i) is at byte offset x * (u_is_double? sizeof(double) : sizeof(float)) + u_pitch * (y + h * (z + d * i)), with z = 0 and d = 1 for images.
+	// For the CUDA engine, u is in device memory (u_is_on_host is false).
+	const void *u;
+	bool u_is_double;
+	bool u_is_on_host;
+	size_t u_pitch;
+	int w;
+	int h;
+	int d;
+	int num_channels;
+};
+
+
+// Progress callback: Return true to continue the iterations, or false to stop them.
+// After stopping, the current solution is returned as the result, and the solver can be used for the next run as usual.
+typedef bool (*ProgressCallback)(const ProgressInfo &info, void *user_data);
+
+
+
+#endif // SOLVER_PROGRESS_H
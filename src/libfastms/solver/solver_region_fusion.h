@@ -0,0 +1,279 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SOLVER_REGION_FUSION_H
+#define SOLVER_REGION_FUSION_H
+
+#include "util/image_access.h"
+#include <vector>
+#include <cmath>
+
+
+
+// Minimization of the piecewise constant Mumford-Shah model (alpha = infinity)
+//
+//   sum_{x,y} |u(x,y) - f(x,y)|^2 + lambda * weight(x,y) * [gradient u(x,y) != 0]
+//
+// by region fusion: Every pixel starts as its own region. Two neighboring regions are merged
+// if the increase of the data term is not larger than the saved jump penalty beta * (length of the common boundary).
+// The penalty beta is increased from 0 to lambda over the iterations.
+// See Nguyen, Brown: "Fast and Effective L0 Gradient Minimization by Region Fusion", ICCV 2015.
+//
+// Host only. The boundary between two regions is measured by the number of (weighted) neighbor pairs,
+// which approximates the per-pixel jump count of the energy above.
+template<typename TImageAccess>
+class RegionFusion
+{
+public:
+	typedef typename TImageAccess::elem_t real;
+
+	RegionFusion() : num_iterations(100), gamma(real(2.2)), num_channels(0) {}
+
+	// Returns the number of performed iterations.
+	int run(TImageAccess u, TImageAccess f, TImageAccess weight, real lambda)
+	{
+		init(f, weight);
+		const bool lambda_infinite = !(lambda >= real(0) && lambda < realmax<real>());
+		int iteration = 0;
+		while (iteration < num_iterations && alive.size() > 1)
+		{
+			iteration++;
+			real beta = (lambda_infinite? realmax<real>() : lambda * std::pow(real(iteration) / real(num_iterations), gamma));
+			if (!(beta > real(0))) { continue; }  // nothing to gain from merging
+			for (size_t k = 0; k < alive.size(); k++)
+			{
+				int i = alive[k];
+				if (parent[i] != i) { continue; }
+				fuse_neighbors(i, beta);
+			}
+			remove_dead();
+		}
+		set_solution(u);
+		return iteration;
+	}
+
+	// Memory of the working arrays for an image of size dim, in bytes
+	static size_t memory(const ArrayDim &dim)
+	{
+		size_t n = (size_t)dim.w * dim.h;
+		return n * (5 * sizeof(int) + (1 + dim.num_channels) * sizeof(real)) + 4 * n * (2 * sizeof(int) + sizeof(real));
+	}
+
+	// Allocates the working arrays for an image of size dim in advance
+	void reserve(const ArrayDim &dim)
+	{
+		size_t n = (size_t)dim.w * dim.h;
+		parent.reserve(n);
+		size.reserve(n);
+		mean.reserve(n * dim.num_channels);
+		head.reserve(n);
+		tail.reserve(n);
+		mark.reserve(n);
+		alive.reserve(n);
+		edge_to.reserve(4 * n);
+		edge_c.reserve(4 * n);
+		edge_next.reserve(4 * n);
+	}
+
+	int num_iterations;
+	real gamma;
+
+private:
+	void init(TImageAccess f, TImageAccess weight)
+	{
+		dim2d = f.dim().dim2d();
+		num_channels = f.dim().num_channels;
+		const int n = (int)dim2d.num_elem();
+		parent.resize(n);
+		size.resize(n);
+		mean.resize((size_t)n * num_channels);
+		head.assign(n, -1);
+		tail.assign(n, -1);
+		mark.assign(n, -1);
+		alive.resize(n);
+		edge_to.clear();
+		edge_c.clear();
+		edge_next.clear();
+		edge_to.reserve((size_t)4 * n);
+		edge_c.reserve((size_t)4 * n);
+		edge_next.reserve((size_t)4 * n);
+		for (int y = 0; y < dim2d.h; y++)
+		{
+			for (int x = 0; x < dim2d.w; x++)
+			{
+				int i = x + dim2d.w * y;
+				parent[i] = i;
+				size[i] = real(1);
+				alive[i] = i;
+				for (int c = 0; c < num_channels; c++) { mean[(size_t)i * num_channels + c] = f.get(x, y, c); }
+
+				// the jump penalty for pixel (x, y) belongs to the forward differences in x and y
+				real weight0 = (weight.is_valid()? weight.get(x, y, 0) : real(1));
+				if (x + 1 < dim2d.w) { add_edge(i, i + 1, weight0); }
+				if (y + 1 < dim2d.h) { add_edge(i, i + dim2d.w, weight0); }
+			}
+		}
+	}
+
+	void add_edge(int a, int b, real c)
+	{
+		push_edge(a, b, c);
+		push_edge(b, a, c);
+	}
+
+	void push_edge(int g, int to, real c)
+	{
+		int e = (int)edge_to.size();
+		edge_to.push_back(to);
+		edge_c.push_back(c);
+		edge_next.push_back(-1);
+		if (tail[g] == -1) { head[g] = e; } else { edge_next[tail[g]] = e; }
+		tail[g] = e;
+	}
+
+	int find(int i)
+	{
+		while (parent[i] != i)
+		{
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	}
+
+	// resolve the neighbor list of region i to current regions, dropping self references and accumulating duplicates
+	void compact(int i)
+	{
+		int prev = -1;
+		int e = head[i];
+		while (e != -1)
+		{
+			int next = edge_next[e];
+			int j = find(edge_to[e]);
+			if (j == i || mark[j] != -1)
+			{
+				if (j != i) { edge_c[mark[j]] += edge_c[e]; }
+				if (prev == -1) { head[i] = next; } else { edge_next[prev] = next; }
+			}
+			else
+			{
+				edge_to[e] = j;
+				mark[j] = e;
+				prev = e;
+			}
+			e = next;
+		}
+		tail[i] = prev;
+		for (e = head[i]; e != -1; e = edge_next[e]) { mark[edge_to[e]] = -1; }
+	}
+
+	void fuse_neighbors(int i, real beta)
+	{
+		compact(i);
+		int e = head[i];
+		const int last = tail[i];
+		while (e != -1)
+		{
+			// merging appends to the list of i, only the compacted part is considered in this iteration
+			int j = edge_to[e];
+			if (parent[j] == j && is_merge_better(i, j, edge_c[e], beta)) { merge(i, j); }
+			if (e == last) { break; }
+			e = edge_next[e];
+		}
+	}
+
+	bool is_merge_better(int i, int j, real boundary, real beta)
+	{
+		// energy increase of the data term when replacing the two means by the common mean:
+		//   size_i * size_j / (size_i + size_j) * |mean_i - mean_j|^2
+		const real *mean_i = &mean[(size_t)i * num_channels];
+		const real *mean_j = &mean[(size_t)j * num_channels];
+		real diff2 = real(0);
+		for (int c = 0; c < num_channels; c++)
+		{
+			real diff = mean_i[c] - mean_j[c];
+			diff2 += diff * diff;
+		}
+		return (size[i] * size[j] * diff2 <= beta * boundary * (size[i] + size[j]));
+	}
+
+	void merge(int i, int j)
+	{
+		real *mean_i = &mean[(size_t)i * num_channels];
+		const real *mean_j = &mean[(size_t)j * num_channels];
+		real size_sum = size[i] + size[j];
+		for (int c = 0; c < num_channels; c++) { mean_i[c] = (size[i] * mean_i[c] + size[j] * mean_j[c]) / size_sum; }
+		size[i] = size_sum;
+		parent[j] = i;
+		if (head[j] != -1)
+		{
+			if (tail[i] == -1) { head[i] = head[j]; } else { edge_next[tail[i]] = head[j]; }
+			tail[i] = tail[j];
+		}
+		head[j] = -1;
+		tail[j] = -1;
+	}
+
+	void remove_dead()
+	{
+		size_t num_alive = 0;
+		for (size_t k = 0; k < alive.size(); k++)
+		{
+			int i = alive[k];
+			if (parent[i] == i) { alive[num_alive++] = i; }
+		}
+		alive.resize(num_alive);
+	}
+
+	void set_solution(TImageAccess u)
+	{
+		const int n = (int)dim2d.num_elem();
+		for (int i = 0; i < n; i++) { parent[i] = find(i); }
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp parallel for
+#endif
+		for (int y = 0; y < dim2d.h; y++)
+		{
+			for (int x = 0; x < dim2d.w; x++)
+			{
+				const real *mean_i = &mean[(size_t)parent[x + dim2d.w * y] * num_channels];
+				for (int c = 0; c < num_channels; c++) { u.get(x, y, c) = mean_i[c]; }
+			}
+		}
+	}
+
+	Dim2D dim2d;
+	int num_channels;
+	std::vector<int> parent;
+	std::vector<real> size;
+	std::vector<real> mean;
+	std::vector<int> alive;
+
+	// neighbor lists as linked lists in a common pool, so that merging two lists is O(1)
+	std::vector<int> head;
+	std::vector<int> tail;
+	std::vector<int> mark;
+	std::vector<int> edge_to;
+	std::vector<real> edge_c;
+	std::vector<int> edge_next;
+};
+
+
+
+#endif // SOLVER_REGION_FUSION_H
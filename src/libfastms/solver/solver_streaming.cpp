@@ -0,0 +1,233 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "solver_streaming.h"
+#include "util/image.h"
+#include <vector>
+#include <algorithm>  // for std::min, std::max
+#include <cstring>  // for memcpy
+#include <iostream>
+
+
+
+class StreamingSolverImplementation
+{
+public:
+	StreamingSolverImplementation() : w(0), num_channels(0), core_rows(0), overlap(0), blend(0), num_pushed(0), next_core(0), is_finished(false) {}
+
+	void begin(int w, int num_channels, const Par &par)
+	{
+		this->w = w;
+		this->num_channels = num_channels;
+		core_rows = (par.tile_size > 0? par.tile_size : 64);
+		overlap = std::max(0, std::min(par.tile_overlap, core_rows));
+		blend = overlap / 2;
+		window_par = par.adapted_to(ArrayDim(w, w, num_channels));
+		window_par.roi_w = 0;
+		window_par.temporal = 0.0;
+		window_par.incremental = false;
+		window_par.time_budget = 0.0;
+		window_par.progress_callback = NULL;
+		window_par.verbose = false;
+		num_pushed = 0;
+		next_core = 0;
+		is_finished = false;
+		rows_in.clear();
+		rows_in_y0 = 0;
+		pending.clear();
+		ready.clear();
+		ready_begin = 0;
+	}
+
+	void push_rows(const BaseImage *rows)
+	{
+		const ArrayDim dim = rows->dim();
+		if (dim.w != w || dim.num_channels != num_channels)
+		{
+			std::cerr << "ERROR: StreamingSolver::push_rows(): Rows of size " << dim << " do not match the strip width " << w << " with " << num_channels << " channels" << std::endl;
+			return;
+		}
+		if (is_finished) { std::cerr << "ERROR: StreamingSolver::push_rows(): The strip is finished, call begin() first" << std::endl; return; }
+		if (dim.h == 0) { return; }
+		// append as rows of w * num_channels values, layered within the row
+		if (scratch.dim() != dim) { scratch.alloc(dim); }
+		rows->copy_to_layered(scratch.get_untyped_access());
+		const size_t row_size = (size_t)w * num_channels;
+		size_t old_size = rows_in.size();
+		rows_in.resize(old_size + row_size * dim.h);
+		for (int y = 0; y < dim.h; y++)
+		{
+			for (int i = 0; i < num_channels; i++)
+			{
+				memcpy(&rows_in[old_size + row_size * y + (size_t)w * i], &scratch.get_access().get(0, y, i), w * sizeof(float));
+			}
+		}
+		num_pushed += dim.h;
+		while (num_pushed >= next_core + core_rows + overlap) { solve_window(next_core + core_rows); }
+	}
+
+	void finish()
+	{
+		is_finished = true;
+		while (next_core < num_pushed) { solve_window(std::min(num_pushed, next_core + core_rows)); }
+	}
+
+	int num_rows_ready() const { return (int)((ready.size() / std::max((size_t)1, (size_t)w * num_channels)) - ready_begin); }
+
+	int pop_rows(BaseImage *out)
+	{
+		const ArrayDim dim_out = out->dim();
+		if (dim_out.w != w || dim_out.num_channels != num_channels)
+		{
+			std::cerr << "ERROR: StreamingSolver::pop_rows(): Output of size " << dim_out << " does not match the strip width " << w << " with " << num_channels << " channels" << std::endl;
+			return 0;
+		}
+		const int num_rows = std::min(num_rows_ready(), dim_out.h);
+		if (num_rows == 0) { return 0; }
+		const size_t row_size = (size_t)w * num_channels;
+		ManagedImage<float, DataInterpretationLayered, HostPoolAllocator> rows_out(ArrayDim(w, num_rows, num_channels));
+		for (int y = 0; y < num_rows; y++)
+		{
+			for (int i = 0; i < num_channels; i++)
+			{
+				memcpy(&rows_out.get_access().get(0, y, i), &ready[row_size * (ready_begin + y) + (size_t)w * i], w * sizeof(float));
+			}
+		}
+		out->copy_region_from_layered(rows_out.get_untyped_access(), 0, 0);
+		ready_begin += num_rows;
+		if (ready_begin * 2 >= ready.size() / row_size)
+		{
+			// drop the popped rows
+			ready.erase(ready.begin(), ready.begin() + row_size * ready_begin);
+			ready_begin = 0;
+		}
+		return num_rows;
+	}
+
+	int get_latency() const { return core_rows + overlap + blend - 1; }
+
+private:
+	// 1d blending weight at row y of the window with core [c0, c1), where the strip ends at row n (or is unfinished if n < 0)
+	double weight(int y, int c0, int c1, int n) const
+	{
+		if (blend == 0) { return (y >= c0 && y < c1? 1.0 : 0.0); }
+		double w = 1.0;
+		if (c0 > 0) { w *= std::min(1.0, std::max(0.0, (y - (c0 - blend) + 0.5) / (2.0 * blend))); }
+		if (c1 != n) { w *= std::min(1.0, std::max(0.0, ((c1 + blend) - y - 0.5) / (2.0 * blend))); }
+		return w;
+	}
+
+	// Solves the window with core rows [next_core, core_end), and moves its finished rows to ready
+	void solve_window(int core_end)
+	{
+		const size_t row_size = (size_t)w * num_channels;
+		const int c0 = next_core;
+		const int c1 = core_end;
+		const int n = (is_finished? num_pushed : -1);
+		const int y0 = std::max(0, c0 - overlap);
+		const int y1 = std::min(num_pushed, c1 + overlap);
+		const ArrayDim dim_window(w, y1 - y0, num_channels);
+		if (window.dim() != dim_window)
+		{
+			window.alloc(dim_window);
+			solution.alloc(dim_window);
+		}
+		for (int y = y0; y < y1; y++)
+		{
+			for (int i = 0; i < num_channels; i++)
+			{
+				memcpy(&window.get_access().get(0, y - y0, i), &rows_in[row_size * (y - rows_in_y0) + (size_t)w * i], w * sizeof(float));
+			}
+		}
+		solver.run_into(&solution, &window, window_par);
+
+		// rows [c0 - blend, c0 + blend) are blended with the pending rows of the previous window, rows up to c1 - blend are final,
+		// and rows [c1 - blend, c1 + blend) are kept as pending for the next window, premultiplied with their weight
+		const int final_end = (c1 == n? c1 : c1 - blend);
+		const int pending_begin = c0 - (c0 > 0? blend : 0);
+		std::vector<float> row(row_size);
+		for (int y = pending_begin; y < final_end; y++)
+		{
+			const double weight_y = weight(y, c0, c1, n);
+			for (size_t k = 0; k < row_size; k++)
+			{
+				int i = (int)(k / w);
+				int x = (int)(k % w);
+				double value = weight_y * solution.get_access().get(x, y - y0, i);
+				if (y - pending_begin < (int)(pending.size() / row_size)) { value += pending[row_size * (y - pending_begin) + k]; }
+				row[k] = (float)value;
+			}
+			ready.insert(ready.end(), row.begin(), row.end());
+		}
+		pending.clear();
+		for (int y = final_end; y < std::min(c1 + blend, y1); y++)
+		{
+			const double weight_y = weight(y, c0, c1, n);
+			for (size_t k = 0; k < row_size; k++)
+			{
+				int i = (int)(k / w);
+				int x = (int)(k % w);
+				pending.push_back((float)(weight_y * solution.get_access().get(x, y - y0, i)));
+			}
+		}
+		next_core = c1;
+
+		// drop the input rows which no later window needs
+		int keep_from = std::max(0, next_core - overlap);
+		if (keep_from > rows_in_y0)
+		{
+			rows_in.erase(rows_in.begin(), rows_in.begin() + row_size * (keep_from - rows_in_y0));
+			rows_in_y0 = keep_from;
+		}
+	}
+
+	int w;
+	int num_channels;
+	int core_rows;
+	int overlap;
+	int blend;
+	Par window_par;
+	Solver solver;
+
+	int num_pushed;
+	int next_core;  // first row which is not finished
+	bool is_finished;
+
+	std::vector<float> rows_in;  // pushed rows from rows_in_y0 on which are still needed, each as w * num_channels values
+	int rows_in_y0;
+	std::vector<float> pending;  // weighted solution of the last window in the rows where the next window blends in, from next_core - blend on
+	std::vector<float> ready;  // finished rows, from ready_begin on
+	size_t ready_begin;
+
+	ManagedImage<float, DataInterpretationLayered, HostPoolAllocator> scratch;
+	ManagedImage<float, DataInterpretationLayered, HostPoolAllocator> window;
+	ManagedImage<float, DataInterpretationLayered, HostPoolAllocator> solution;
+};
+
+
+
+StreamingSolver::StreamingSolver() : implementation(new StreamingSolverImplementation()) {}
+StreamingSolver::~StreamingSolver() { delete implementation; }
+void StreamingSolver::begin(int w, int num_channels, const Par &par) { implementation->begin(w, num_channels, par); }
+void StreamingSolver::push_rows(const BaseImage *rows) { implementation->push_rows(rows); }
+void StreamingSolver::finish() { implementation->finish(); }
+int StreamingSolver::num_rows_ready() const { return implementation->num_rows_ready(); }
+int StreamingSolver::pop_rows(BaseImage *out) { return implementation->pop_rows(out); }
+int StreamingSolver::get_latency() const { return implementation->get_latency(); }
@@ -0,0 +1,72 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SOLVER_STREAMING_H
+#define SOLVER_STREAMING_H
+
+#include "solver.h"
+
+
+
+// p_impl design pattern to reduce header to the minimum in order to avoid unnecessary dependencies
+class StreamingSolverImplementation;
+
+
+// Solver for an endless strip of image rows, e.g. from a line-scan camera, with constant memory.
+// The rows are pushed as they arrive, and the finished rows of the solution can be popped once they are far enough behind the last pushed row.
+// The strip is solved in windows of par.tile_size rows (64 if <= 0) plus par.tile_overlap rows above and below,
+// and consecutive windows are blended linearly in the inner half of the overlap, as in TiledSolver.
+// A row can be popped after at most about tile_size + 1.5 * tile_overlap further rows have been pushed, see get_latency().
+// With adapt_params, lambda and alpha are adapted as for a w x w image.
+// Temporal regularization, incremental mode, time budget and the progress callback are not used.
+class StreamingSolver
+{
+public:
+	StreamingSolver();
+	~StreamingSolver();
+
+	// Starts a new strip with rows of width w, discarding all rows of the previous strip.
+	void begin(int w, int num_channels, const Par &par);
+
+	// Appends the rows of the image rows (of width w, any elem type and layout), e.g. a ManagedImage of size w x 1 wrapping the camera buffer.
+	void push_rows(const BaseImage *rows);
+
+	// Marks the end of the strip, so that all remaining rows are computed.
+	void finish();
+
+	// Number of finished rows which can be popped.
+	int num_rows_ready() const;
+
+	// Writes min(num_rows_ready(), out->dim().h) finished rows to the top rows of out, and returns their number.
+	int pop_rows(BaseImage *out);
+
+	// Maximal number of rows pushed after a row before it is ready (before finish()).
+	int get_latency() const;
+
+private:
+	StreamingSolver(const StreamingSolver &other_solver);  // disable
+	StreamingSolver& operator= (const StreamingSolver &other_solver);  // disable
+
+	StreamingSolverImplementation *implementation;
+};
+
+
+
+#endif // SOLVER_STREAMING_H
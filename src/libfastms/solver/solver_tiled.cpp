@@ -0,0 +1,344 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "solver_tiled.h"
+#include "util/image.h"
+#include "util/has_cuda.h"
+#include "util/timer.h"
+#include <vector>
+#include <algorithm>  // for std::min, std::max
+#include <cstdio>  // for snprintf
+#include <iostream>
+
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+#include <omp.h>
+#endif
+
+
+
+namespace
+{
+
+// The cores of the tiles partition the image into num_x * num_y nearly equal parts.
+// Each tile is computed on its core plus the overlap, and written to its core plus half the overlap,
+// where it is blended with the neighboring tiles by linear weights which sum up to 1.
+struct TileGrid
+{
+	TileGrid(const ArrayDim &dim, int tile_size, int overlap) : dim(dim), overlap(overlap), blend(overlap / 2)
+	{
+		num_x = std::max(1, (dim.w + tile_size - 1) / tile_size);
+		num_y = std::max(1, (dim.h + tile_size - 1) / tile_size);
+	}
+	int num_tiles() const { return num_x * num_y; }
+
+	static int core_begin(int k, int num, int size) { return (int)((long long)k * size / num); }
+	int core_x0(int tx) const { return core_begin(tx, num_x, dim.w); }
+	int core_x1(int tx) const { return core_begin(tx + 1, num_x, dim.w); }
+	int core_y0(int ty) const { return core_begin(ty, num_y, dim.h); }
+	int core_y1(int ty) const { return core_begin(ty + 1, num_y, dim.h); }
+
+	// 1d blending weight at position x of the tile with core [c0, c1), in an image of size n
+	double weight(int x, int c0, int c1, int n) const
+	{
+		double w = 1.0;
+		if (blend == 0) { return (x >= c0 && x < c1? 1.0 : 0.0); }
+		if (c0 > 0) { w *= std::min(1.0, std::max(0.0, (x - (c0 - blend) + 0.5) / (2.0 * blend))); }
+		if (c1 < n) { w *= std::min(1.0, std::max(0.0, ((c1 + blend) - x - 0.5) / (2.0 * blend))); }
+		return w;
+	}
+
+	ArrayDim dim;
+	int overlap;
+	int blend;
+	int num_x;
+	int num_y;
+};
+
+
+// lambda and alpha for the size of the whole image
+Par get_tile_par(const ArrayDim &dim, const Par &par)
+{
+	Par tile_par = par.adapted_to(dim);
+	tile_par.roi_w = 0;
+	tile_par.temporal = 0.0;
+	tile_par.incremental = false;
+	tile_par.time_budget = 0.0;
+	tile_par.progress_callback = NULL;
+	tile_par.verbose = false;
+	return tile_par;
+}
+
+} // namespace
+
+
+
+class TiledSolverImplementation
+{
+public:
+	TiledSolverImplementation() {}
+	~TiledSolverImplementation()
+	{
+		for (size_t k = 0; k < solvers.size(); k++) { delete solvers[k]; }
+	}
+
+	void run_into(BaseImage *out, const BaseImage *in, const Par &par)
+	{
+		if (par.use_double) { run_into_real<double>(out, in, par); }
+		else { run_into_real<float>(out, in, par); }
+	}
+
+	// Chooses the tile size and the number of parallel tiles
+	void plan(const ArrayDim &dim, const Par &par, int *tile_size, int *num_workers, int *overlap)
+	{
+		Par tile_par = get_tile_par(dim, par);
+		int max_workers = 1;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		max_workers = omp_get_max_threads();
+#endif
+		if (par.engine == Par::engine_cuda && has_cuda()) { max_workers = 1; }  // the tiles are computed one after the other on the GPU
+		*overlap = std::max(0, par.tile_overlap);
+		const int full_size = std::max(dim.w, dim.h);
+		int workers = max_workers;
+		int size = full_size;
+		if (par.tile_size > 0)
+		{
+			size = par.tile_size;
+		}
+		else if (par.tile_max_memory > 0.0)
+		{
+			const double max_bytes = par.tile_max_memory * 1024.0 * 1024.0;
+			const int min_size = std::min(full_size, std::max(2 * *overlap, 16));
+			while (workers > 1 && (double)workers * memory(dim, min_size, *overlap, tile_par) > max_bytes) { workers--; }
+			if ((double)workers * memory(dim, min_size, *overlap, tile_par) > max_bytes)
+			{
+				if (par.verbose) { std::cerr << "WARNING: TiledSolver: Even tiles of size " << min_size << " exceed tile_max_memory = " << par.tile_max_memory << " MB" << std::endl; }
+				size = min_size;
+			}
+			else
+			{
+				// largest size under the cap
+				int lo = min_size;
+				int hi = full_size;
+				while (lo < hi)
+				{
+					int mid = lo + (hi - lo + 1) / 2;
+					if ((double)workers * memory(dim, mid, *overlap, tile_par) <= max_bytes) { lo = mid; } else { hi = mid - 1; }
+				}
+				size = lo;
+			}
+		}
+		size = std::max(1, std::min(size, full_size));
+		*overlap = std::min(*overlap, size / 2);
+		TileGrid grid(dim, size, *overlap);
+		*tile_size = size;
+		*num_workers = std::max(1, std::min(workers, grid.num_tiles()));
+	}
+
+private:
+	// Memory of one tile: the solver arrays, and the input, solution and output buffers
+	size_t memory(const ArrayDim &dim, int tile_size, int overlap, const Par &tile_par)
+	{
+		ArrayDim dim_tile(std::min(dim.w, tile_size + 2 * overlap), std::min(dim.h, tile_size + 2 * overlap), dim.num_channels);
+		size_t elem_size = (tile_par.use_double? sizeof(double) : sizeof(float));
+		size_t buffers = 3 * (size_t)dim_tile.num_elem() * elem_size;
+		Solver estimator;
+		return estimator.estimate_memory(dim_tile, tile_par) + buffers;
+	}
+
+	template<typename real> void run_into_real(BaseImage *out, const BaseImage *in, const Par &par)
+	{
+		typedef ManagedImage<real, DataInterpretationLayered, HostPoolAllocator> tile_image_t;
+
+		const ArrayDim dim = in->dim();
+		if (out->dim() != dim)
+		{
+			std::cerr << "ERROR: TiledSolver::run_into(): Output size " << out->dim() << " differs from input size " << dim << ", nothing computed" << std::endl;
+			return;
+		}
+		Timer timer_all;
+		timer_all.start();
+		Par tile_par = get_tile_par(dim, par);
+		if (tile_par.engine == Par::engine_cuda)
+		{
+			std::string error_str;
+			if (!has_cuda(&error_str))
+			{
+				std::cerr << "ERROR: TiledSolver::run(): Could not select CUDA engine, USING CPU VERSION INSTEAD (" << error_str.c_str() << ")." << std::endl;
+				tile_par.engine = Par::engine_cpu;
+			}
+		}
+		int tile_size = 0;
+		int num_workers = 1;
+		int overlap = 0;
+		plan(dim, tile_par, &tile_size, &num_workers, &overlap);
+		const TileGrid grid(dim, tile_size, overlap);
+		const int num_tiles = grid.num_tiles();
+		while ((int)solvers.size() < num_workers) { solvers.push_back(new Solver()); }
+		std::vector<char> is_done(num_tiles, 0);
+
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp parallel for schedule(dynamic) num_threads(num_workers) if(num_workers > 1)
+#endif
+		for (int t = 0; t < num_tiles; t++)
+		{
+			int worker = 0;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+			if (num_workers > 1) { worker = omp_get_thread_num(); }
+#endif
+			const int tx = t % grid.num_x;
+			const int ty = t / grid.num_x;
+
+			// compute the tile on its core plus the overlap
+			const int ex0 = std::max(0, grid.core_x0(tx) - overlap);
+			const int ey0 = std::max(0, grid.core_y0(ty) - overlap);
+			const int ex1 = std::min(dim.w, grid.core_x1(tx) + overlap);
+			const int ey1 = std::min(dim.h, grid.core_y1(ty) + overlap);
+			const ArrayDim dim_tile(ex1 - ex0, ey1 - ey0, dim.num_channels);
+			tile_image_t in_tile(dim_tile);
+			tile_image_t solution(dim_tile);
+			in->copy_region_to_layered(in_tile.get_untyped_access(), ex0, ey0);
+			solvers[worker]->run_into(&solution, &in_tile, tile_par);
+
+			// blend it into the output
+			const int wx0 = std::max(0, grid.core_x0(tx) - grid.blend);
+			const int wy0 = std::max(0, grid.core_y0(ty) - grid.blend);
+			const int wx1 = std::min(dim.w, grid.core_x1(tx) + grid.blend);
+			const int wy1 = std::min(dim.h, grid.core_y1(ty) + grid.blend);
+			tile_image_t blended(ArrayDim(wx1 - wx0, wy1 - wy0, dim.num_channels));
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+			#pragma omp critical (tiled_solver_output)
+#endif
+			{
+				blend_tile(out, grid, tx, ty, is_done, solution.get_access(), ex0, ey0, blended.get_access(), wx0, wy0);
+				is_done[t] = 1;
+			}
+		}
+
+		timer_all.end();
+		if (par.verbose)
+		{
+			char buffer[256];
+			snprintf(buffer, sizeof(buffer), "%2.4f s", timer_all.get());
+			std::cout << "TiledSolver: " << dim << ", " << num_tiles << " tiles of size " << tile_size << " + overlap " << overlap
+					<< ", " << num_workers << " in parallel, " << (num_workers * memory(dim, tile_size, overlap, tile_par) + (1<<20) - 1) / (1<<20) << " MB, "
+					<< buffer << std::endl;
+		}
+	}
+
+	// Writes the solution of tile (tx, ty) to the output, as the weighted average with the neighboring tiles written before.
+	// The output contains the weighted average of the written tiles, so each new tile is blended in with its weight relative to the sum.
+	template<typename real> void blend_tile(BaseImage *out, const TileGrid &grid, int tx, int ty, const std::vector<char> &is_done,
+			ImageAccess<real, DataInterpretationLayered> solution, int ex0, int ey0, ImageAccess<real, DataInterpretationLayered> blended, int wx0, int wy0)
+	{
+		const ArrayDim dim_blended = blended.dim();
+		std::vector<double> weights_x[3];
+		std::vector<double> weights_y[3];
+		bool has_done_neighbor = false;
+		for (int d = -1; d <= 1; d++)
+		{
+			weights_x[d + 1].assign(dim_blended.w, 0.0);
+			weights_y[d + 1].assign(dim_blended.h, 0.0);
+			if (tx + d >= 0 && tx + d < grid.num_x)
+			{
+				for (int x = 0; x < dim_blended.w; x++) { weights_x[d + 1][x] = grid.weight(wx0 + x, grid.core_x0(tx + d), grid.core_x1(tx + d), grid.dim.w); }
+			}
+			if (ty + d >= 0 && ty + d < grid.num_y)
+			{
+				for (int y = 0; y < dim_blended.h; y++) { weights_y[d + 1][y] = grid.weight(wy0 + y, grid.core_y0(ty + d), grid.core_y1(ty + d), grid.dim.h); }
+			}
+		}
+		char neighbor_is_done[3][3];
+		for (int dy = -1; dy <= 1; dy++)
+		{
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				bool inside = (tx + dx >= 0 && tx + dx < grid.num_x && ty + dy >= 0 && ty + dy < grid.num_y);
+				neighbor_is_done[dy + 1][dx + 1] = ((dx != 0 || dy != 0) && inside && is_done[(ty + dy) * grid.num_x + tx + dx]);
+				if (neighbor_is_done[dy + 1][dx + 1]) { has_done_neighbor = true; }
+			}
+		}
+		if (has_done_neighbor)
+		{
+			out->copy_region_to_layered(blended.get_untyped_access(), wx0, wy0);
+		}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp parallel for
+#endif
+		for (int y = 0; y < dim_blended.h; y++)
+		{
+			for (int x = 0; x < dim_blended.w; x++)
+			{
+				double weight_done = 0.0;
+				if (has_done_neighbor)
+				{
+					for (int dy = 0; dy < 3; dy++)
+					{
+						for (int dx = 0; dx < 3; dx++)
+						{
+							if (neighbor_is_done[dy][dx]) { weight_done += weights_x[dx][x] * weights_y[dy][y]; }
+						}
+					}
+				}
+				const double weight = weights_x[1][x] * weights_y[1][y];
+				const double factor = (weight_done > 0.0? weight / (weight + weight_done) : 1.0);
+				for (int i = 0; i < dim_blended.num_channels; i++)
+				{
+					real value = solution.get(wx0 + x - ex0, wy0 + y - ey0, i);
+					real &result = blended.get(x, y, i);
+					result = (factor < 1.0? (real)(factor * value + (1.0 - factor) * result) : value);
+				}
+			}
+		}
+		out->copy_region_from_layered(blended.get_untyped_access(), wx0, wy0);
+	}
+
+	std::vector<Solver*> solvers;  // one per parallel tile, to keep their arrays between the tiles
+};
+
+
+
+TiledSolver::TiledSolver() : implementation(new TiledSolverImplementation()) {}
+TiledSolver::~TiledSolver() { delete implementation; }
+void TiledSolver::run_into(BaseImage *out, const BaseImage *in, const Par &par)
+{
+	implementation->run_into(out, in, par);
+}
+BaseImage* TiledSolver::run(const BaseImage *in, const Par &par)
+{
+	BaseImage *out = in->new_of_same_type_and_size();
+	implementation->run_into(out, in, par);
+	return out;
+}
+int TiledSolver::get_tile_size(const ArrayDim &dim, const Par &par)
+{
+	int tile_size = 0;
+	int num_workers = 0;
+	int overlap = 0;
+	implementation->plan(dim, par, &tile_size, &num_workers, &overlap);
+	return tile_size;
+}
+int TiledSolver::get_num_workers(const ArrayDim &dim, const Par &par)
+{
+	int tile_size = 0;
+	int num_workers = 0;
+	int overlap = 0;
+	implementation->plan(dim, par, &tile_size, &num_workers, &overlap);
+	return num_workers;
+}
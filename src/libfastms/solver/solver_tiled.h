@@ -0,0 +1,64 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SOLVER_TILED_H
+#define SOLVER_TILED_H
+
+#include "solver.h"
+
+
+
+// p_impl design pattern to reduce header to the minimum in order to avoid unnecessary dependencies
+class TiledSolverImplementation;
+
+
+// Solver for images which do not fit into memory, e.g. a MappedImage (util/image_mapped.h), computed tile by tile.
+// Each tile is computed with par.tile_overlap additional pixels on each side and blended with its neighbors, to avoid seams.
+// The tile size is chosen from the memory cap par.tile_max_memory (or set by par.tile_size), and the tiles are computed in parallel on all cores.
+// Only the tiles and their solver arrays are kept in memory. The input and output are accessed by BaseImage::copy_region_to_layered()
+// and copy_region_from_layered(), which all image classes of the library provide without a full size copy.
+// With adapt_params, lambda and alpha are adapted to the size of the whole image. With weight, the edge weight is computed per tile.
+// Temporal regularization, incremental mode, time budget and the progress callback are not used.
+class TiledSolver
+{
+public:
+	TiledSolver();
+	~TiledSolver();
+
+	// Writes the result into out, which must have the size of in, e.g. a writable MappedImage.
+	void run_into(BaseImage *out, const BaseImage *in, const Par &par);
+
+	// Allocates the result with in->new_of_same_type_and_size(), i.e. in memory.
+	BaseImage* run(const BaseImage *in, const Par &par);
+
+	// Tile size (without the overlap) and number of tiles computed in parallel, for an image of size dim with the parameters par.
+	int get_tile_size(const ArrayDim &dim, const Par &par);
+	int get_num_workers(const ArrayDim &dim, const Par &par);
+
+private:
+	TiledSolver(const TiledSolver &other_solver);  // disable
+	TiledSolver& operator= (const TiledSolver &other_solver);  // disable
+
+	TiledSolverImplementation *implementation;
+};
+
+
+
+#endif // SOLVER_TILED_H
@@ -0,0 +1,189 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SOLVER_UPSAMPLE_H
+#define SOLVER_UPSAMPLE_H
+
+#include "util/image_access.h"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+
+
+// Downsampling of f and guided upsampling of a low resolution solution, for solving at a reduced resolution (Par::downscale).
+//
+// The upsampling is a joint bilateral upsampling (Kopf et al.: "Joint Bilateral Upsampling", SIGGRAPH 2007):
+// the value at a full resolution pixel is a weighted mean of the low resolution solution u over the 4 x 4 nearest low resolution pixels q,
+//
+//   weight(q) = exp(-|x - q|^2 / 2) * exp(-|f(x) - u(q)|^2 / (2 * sigma_range^2 * num_channels)),
+//
+// with |x - q| measured in low resolution pixels. The range term compares the full resolution f with the solution,
+// so a pixel takes the value of the segment it belongs to and the discontinuities of u are kept. If all range weights vanish,
+// the nearest value of u in the range sense is taken.
+//
+// Host only, on layered arrays. The loops run along rows over contiguous row buffers, so that the compiler can vectorize them.
+template<typename TImageAccess>
+class GuidedUpsampling
+{
+public:
+	typedef typename TImageAccess::elem_t real;
+
+	// Size of the low resolution image for an image of size dim
+	static ArrayDim low_dim(const ArrayDim &dim, int factor)
+	{
+		return ArrayDim((dim.w + factor - 1) / factor, (dim.h + factor - 1) / factor, dim.num_channels);
+	}
+
+	// Box filter: every low resolution pixel is the mean of the (at most) factor x factor pixels it covers
+	static void downsample(TImageAccess low, TImageAccess full, int factor)
+	{
+		const ArrayDim dim = full.dim();
+		const ArrayDim dim_low = low.dim();
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp parallel for
+#endif
+		for (int yl = 0; yl < dim_low.h; yl++)
+		{
+			const int y0 = yl * factor;
+			const int y1 = std::min(y0 + factor, (int)dim.h);
+			for (int i = 0; i < dim.num_channels; i++)
+			{
+				real *out = &low.get(0, yl, i);
+				for (int xl = 0; xl < dim_low.w; xl++) { out[xl] = real(0); }
+				for (int y = y0; y < y1; y++)
+				{
+					const real *in = &full.get(0, y, i);
+					for (int xl = 0; xl < dim_low.w; xl++)
+					{
+						const int x0 = xl * factor;
+						const int x1 = std::min(x0 + factor, (int)dim.w);
+						real sum = real(0);
+						for (int x = x0; x < x1; x++) { sum += in[x]; }
+						out[xl] += sum;
+					}
+				}
+				for (int xl = 0; xl < dim_low.w; xl++)
+				{
+					const int x1 = std::min(xl * factor + factor, (int)dim.w);
+					out[xl] /= real((y1 - y0) * (x1 - xl * factor));
+				}
+			}
+		}
+	}
+
+	static void upsample(TImageAccess out, TImageAccess low, TImageAccess guide, int factor, real sigma_range)
+	{
+		const ArrayDim dim = out.dim();
+		const ArrayDim dim_low = low.dim();
+		const int num_channels = dim.num_channels;
+		const real range_coeff = real(-0.5) / (sigma_range * sigma_range * real(num_channels));
+
+		// low resolution position of each column, shared by all rows
+		std::vector<int> x_low(dim.w);
+		std::vector<real> x_frac(dim.w);
+		for (int x = 0; x < dim.w; x++)
+		{
+			real pos = (real(x) + real(0.5)) / real(factor) - real(0.5);
+			x_low[x] = (int)std::floor(pos);
+			x_frac[x] = pos - real(x_low[x]);
+		}
+
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp parallel
+		{
+#endif
+		std::vector<real> acc(dim.w * num_channels);
+		std::vector<real> weight_sum(dim.w);
+		std::vector<real> dist(dim.w);
+		std::vector<real> best_dist(dim.w);
+		std::vector<int> best_x(dim.w);
+		std::vector<int> best_y(dim.w);
+		std::vector<int> qx(dim.w);
+		std::vector<real> weight_x(dim.w);
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp for
+#endif
+		for (int y = 0; y < dim.h; y++)
+		{
+			real pos_y = (real(y) + real(0.5)) / real(factor) - real(0.5);
+			int y_low = (int)std::floor(pos_y);
+			real y_frac = pos_y - real(y_low);
+			std::fill(acc.begin(), acc.end(), real(0));
+			std::fill(weight_sum.begin(), weight_sum.end(), real(0));
+			std::fill(best_dist.begin(), best_dist.end(), realmax<real>());
+
+			for (int dy = -1; dy <= 2; dy++)
+			{
+				const int yq = std::max(0, std::min(y_low + dy, (int)dim_low.h - 1));
+				const real weight_y = std::exp(real(-0.5) * (real(dy) - y_frac) * (real(dy) - y_frac));
+				for (int dx = -1; dx <= 2; dx++)
+				{
+					for (int x = 0; x < dim.w; x++)
+					{
+						qx[x] = std::max(0, std::min(x_low[x] + dx, (int)dim_low.w - 1));
+						real d = real(dx) - x_frac[x];
+						weight_x[x] = weight_y * std::exp(real(-0.5) * d * d);
+						dist[x] = real(0);
+					}
+					for (int i = 0; i < num_channels; i++)
+					{
+						const real *f_row = &guide.get(0, y, i);
+						const real *u_row = &low.get(0, yq, i);
+						for (int x = 0; x < dim.w; x++)
+						{
+							real diff = f_row[x] - u_row[qx[x]];
+							dist[x] += diff * diff;
+						}
+					}
+					for (int x = 0; x < dim.w; x++)
+					{
+						if (dist[x] < best_dist[x]) { best_dist[x] = dist[x]; best_x[x] = qx[x]; best_y[x] = yq; }
+						weight_x[x] *= std::exp(range_coeff * dist[x]);
+						weight_sum[x] += weight_x[x];
+					}
+					for (int i = 0; i < num_channels; i++)
+					{
+						const real *u_row = &low.get(0, yq, i);
+						real *acc_row = &acc[dim.w * i];
+						for (int x = 0; x < dim.w; x++) { acc_row[x] += weight_x[x] * u_row[qx[x]]; }
+					}
+				}
+			}
+
+			for (int i = 0; i < num_channels; i++)
+			{
+				real *out_row = &out.get(0, y, i);
+				const real *acc_row = &acc[dim.w * i];
+				for (int x = 0; x < dim.w; x++)
+				{
+					out_row[x] = (weight_sum[x] > real(1e-20)? acc_row[x] / weight_sum[x] : low.get(best_x[x], best_y[x], i));
+				}
+			}
+		}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		}
+#endif
+	}
+};
+
+
+
+#endif // SOLVER_UPSAMPLE_H
@@ -38,6 +38,9 @@ public:
 
 	// general
 	virtual BaseVolume* run(const BaseVolume *in, const Par3 &par) = 0;
+	virtual void run_into(BaseVolume *out, const BaseVolume *in, const Par3 &par) = 0;
+	virtual size_t estimate_memory(const ArrayDim3 &dim, const Par3 &par) = 0;
+	virtual void reserve(const ArrayDim3 &dim, const Par3 &par) = 0;
 
 	// layered real
 	virtual void run(float *&out_volume, const float *in_volume, const ArrayDim3 &dim, const Par3 &par) = 0;
@@ -48,6 +51,7 @@ public:
 	
 	// VolMat
 	virtual VolMat run(const VolMat in_volume, const Par3 &par) = 0;
+	virtual void run_into(VolMat out_volume, const VolMat in_volume, const Par3 &par) = 0;
 
 	virtual int get_class_type() = 0; // for is_instance_of()
 };
@@ -68,6 +72,18 @@ public:
 	{
 		return volume_solver.run(in, par);
 	}
+	virtual void run_into(BaseVolume *out, const BaseVolume *in, const Par3 &par)
+	{
+		volume_solver.run_into(out, in, par);
+	}
+	virtual size_t estimate_memory(const ArrayDim3 &dim, const Par3 &par)
+	{
+		return volume_solver.estimate_memory(dim, par);
+	}
+	virtual void reserve(const ArrayDim3 &dim, const Par3 &par)
+	{
+		volume_solver.reserve(dim, par);
+	}
 
 	// layered real
 	virtual void run(float *&out_volume, const float *in_volume, const ArrayDim3 &dim, const Par3 &par)
@@ -83,18 +99,16 @@ public:
 		typedef ManagedVolume<real, DataInterpretationLayered> managed_volume_t;
 
 		managed_volume_t in_managed(const_cast<real*>(in_volume), dim);
-		managed_volume_t *out_managed = static_cast<managed_volume_t*>(volume_solver.run(&in_managed, par));
 		if (out_volume)
 		{
-			// copy
+			// write directly into the given memory
 			managed_volume_t outvolume_managed(out_volume, dim);
-			outvolume_managed.copy_from_samekind(out_managed);
-		}
-		else
-		{
-			// move
-			out_volume = out_managed->release_data();
+			volume_solver.run_into(&outvolume_managed, &in_managed, par);
+			return;
 		}
+		// move
+		managed_volume_t *out_managed = static_cast<managed_volume_t*>(volume_solver.run(&in_managed, par));
+		out_volume = out_managed->release_data();
 		delete out_managed;
 	}
 
@@ -104,18 +118,16 @@ public:
 		typedef ManagedVolume<unsigned char, DataInterpretationInterlaced> managed_volume_t;
 
 		managed_volume_t in_managed(const_cast<unsigned char*>(in_volume), dim);
-		managed_volume_t *out_managed = static_cast<managed_volume_t*>(volume_solver.run(&in_managed, par));
 		if (out_volume)
 		{
-			// copy
+			// write directly into the given memory
 			managed_volume_t outvolume_managed(out_volume, dim);
-			outvolume_managed.copy_from_samekind(out_managed);
-		}
-		else
-		{
-			// move
-			out_volume = out_managed->release_data();
+			volume_solver.run_into(&outvolume_managed, &in_managed, par);
+			return;
 		}
+		// move
+		managed_volume_t *out_managed = static_cast<managed_volume_t*>(volume_solver.run(&in_managed, par));
+		out_volume = out_managed->release_data();
 		delete out_managed;
 	}
 
@@ -127,6 +139,12 @@ public:
 		delete out_matvolume;
 		return out_mat;
 	}
+	void run_into(VolMat out_volume, const VolMat in_volume, const Par3 &par)
+	{
+		MatVolume in_matvolume(in_volume);
+		MatVolume out_matvolume(out_volume);
+		volume_solver.run_into(&out_matvolume, &in_matvolume, par);
+	}
 
 
 
@@ -223,6 +241,25 @@ BaseVolume* Solver3::run(const BaseVolume *in, const Par3 &par)
 	set_implementation(implementation, par); if (!implementation) { return NULL; }
 	return implementation->run(in, par);
 }
+void Solver3::run_into(BaseVolume *out, const BaseVolume *in, const Par3 &par)
+{
+	set_implementation(implementation, par); if (!implementation) { return; }
+	implementation->run_into(out, in, par);
+}
+size_t Solver3::estimate_memory(const ArrayDim3 &dim, const Par3 &par)
+{
+	// separate implementation, so that the current one (and its arrays) is kept even if par selects another precision or engine
+	SolverImplementation3 *estimator = NULL;
+	set_implementation(estimator, par); if (!estimator) { return 0; }
+	size_t mem = estimator->estimate_memory(dim, par);
+	delete estimator;
+	return mem;
+}
+void Solver3::reserve(const ArrayDim3 &dim, const Par3 &par)
+{
+	set_implementation(implementation, par); if (!implementation) { return; }
+	implementation->reserve(dim, par);
+}
 void Solver3::run(float *&out_volume, const float *in_volume, const ArrayDim3 &dim, const Par3 &par)
 {
 	set_implementation_real<float>(implementation, par); if (!implementation) { return; }
@@ -243,3 +280,8 @@ VolMat Solver3::run(const VolMat in_volume, const Par3 &par)
 	set_implementation(implementation, par); if (!implementation) { return VolMat(); }
 	return implementation->run(in_volume, par);
 }
+void Solver3::run_into(VolMat out_volume, const VolMat in_volume, const Par3 &par)
+{
+	set_implementation(implementation, par); if (!implementation) { return; }
+	implementation->run_into(out_volume, in_volume, par);
+}
@@ -22,6 +22,7 @@
 
 #include <iostream>
 #include "util/volume_mat.h"
+#include "solver_progress.h"
 
 
 struct Par3
@@ -39,6 +40,11 @@ struct Par3
 		edges = false;
 		use_double = false;
 		engine = engine_cuda;
+		layout = layout_layered;
+		sparse = false;
+		progress_callback = NULL;
+		progress_user_data = NULL;
+		progress_k = 10;
 		verbose = true;
 	}
 	// VolMat
@@ -58,6 +64,9 @@ struct Par3
 	    std::cout << "  edges: " << edges << "\n";
 	    std::cout << "  use_double: " << use_double << "\n";
 	    std::cout << "  engine: " << (engine == Par3::engine_cpu? "cpu" : "cuda") << "\n";
+	    std::cout << "  layout: " << (layout == Par3::layout_bricked? "bricked" : "layered") << "\n";
+	    std::cout << "  sparse: " << sparse << "\n";
+	    std::cout << "  progress_k: " << progress_k << "\n";
 	}
 
 	// Length penalization parameter.
@@ -134,6 +143,28 @@ struct Par3
 	static const int engine_cpu = 0;
 	static const int engine_cuda = 1;
 
+	// Memory layout of the solver arrays on the CPU (ignored for CUDA).
+	//   layout_layered: one x-y plane after the other, channel by channel.
+	//   layout_bricked: 8 x 8 x 8 bricks, so that the neighbors of a voxel lie in the same few cache lines.
+	//     The steps then run brick by brick instead of streaming through the planes, and the progress callback gets no view of u (ProgressInfo::u = NULL).
+	int layout;
+	static const int layout_layered = 0;
+	static const int layout_bricked = 1;
+
+	// If true: Empty-space skipping on the CPU (ignored for CUDA), for volumes which are mostly constant background.
+	//   The 8 x 8 x 8 bricks which are constant in the input, as are all their neighbor bricks, are pinned at their value, and the iterations
+	//   only visit the other bricks. The set of active bricks is updated every 8 iterations. If more than half of the bricks are active, the whole volume
+	//   is iterated until the next update instead, which is faster then. The result and the energy are the same as without it.
+	bool sparse;
+
+    // Progress callback, called every progress_k iterations with the number of iterations, the current value of the stopping criterion
+    // and a read-only view of the current solution, see ProgressInfo. If it returns false, the iterations are stopped and the current solution is returned.
+    // progress_user_data is passed to the callback as is.
+    // Value NULL: No callback.
+    ProgressCallback progress_callback;
+    void *progress_user_data;
+    int progress_k;
+
 	// If true: Output information:
 	//   - image dimensions
 	//   - required memory
@@ -161,6 +192,19 @@ public:
 	// general
 	BaseVolume* run(const BaseVolume *in, const Par3 &par);
 
+	// Writes the result directly into out, which must have the size of in (the elem type and layout may differ).
+	// Together with reserve(), a run allocates no memory apart from the input conversion on CUDA.
+	void run_into(BaseVolume *out, const BaseVolume *in, const Par3 &par);
+
+	// Memory in bytes which run() will allocate for a volume of size dim with the parameters par:
+	// all solver arrays, and on CUDA the temporary device copy for the volume conversion. The result volume itself is not included.
+	size_t estimate_memory(const ArrayDim3 &dim, const Par3 &par);
+
+	// Allocates the memory for a volume of size dim with the parameters par in advance, so that the next run() does not need to allocate.
+	void reserve(const ArrayDim3 &dim, const Par3 &par);
+
+	// Raw pointer versions: if out_volume is not NULL, the result is written directly into it, otherwise out_volume receives newly allocated memory.
+
 	// layered real
 	void run(float *&out_volume, const float *in_volume, const ArrayDim3 &dim, const Par3 &par);
 	void run(double *&out_volume, const double *in_volume, const ArrayDim3 &dim, const Par3 &par);
@@ -170,6 +214,7 @@ public:
 
 	// VolMat
 	VolMat run(const VolMat in_image, const Par3 &par);
+	void run_into(VolMat out_image, const VolMat in_image, const Par3 &par);  // out_image must be allocated with the size and number of channels of in_image
 
 private:
 	Solver3(const Solver3 &other_solver);  // disable
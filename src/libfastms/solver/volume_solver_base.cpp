@@ -23,29 +23,86 @@
 
 
 
+namespace
+{
+
+// BaseVolume converts from and to the layered layout, other layouts of the solver arrays go through a layered copy on the host
+inline void copy_to_solver_layout(VolumeUntypedAccess<DataInterpretationLayered> out, const BaseVolume *volume)
+{
+	volume->copy_to_layered(out);
+}
+template<typename TUntypedAccess>
+void copy_to_solver_layout(TUntypedAccess out, const BaseVolume *volume)
+{
+	VolumeUntypedAccess<DataInterpretationLayered> layered = alloc_untyped_access<VolumeUntypedAccess<DataInterpretationLayered> >(out.dim(), out.elem_kind(), true);  // true = on_host
+	volume->copy_to_layered(layered);
+	copy_volume(out, layered);
+	void *data = layered.data();
+	HostAllocator3::free(data);
+}
+
+inline void copy_from_solver_layout(BaseVolume *volume, const VolumeUntypedAccess<DataInterpretationLayered> &in)
+{
+	volume->copy_from_layered(in);
+}
+template<typename TUntypedAccess>
+void copy_from_solver_layout(BaseVolume *volume, const TUntypedAccess &in)
+{
+	VolumeUntypedAccess<DataInterpretationLayered> layered = alloc_untyped_access<VolumeUntypedAccess<DataInterpretationLayered> >(in.dim(), in.elem_kind(), true);  // true = on_host
+	copy_volume(layered, in);
+	volume->copy_from_layered(layered);
+	void *data = layered.data();
+	HostAllocator3::free(data);
+}
+
+// The input volume itself as f, if it is stored in the layered layout with the elem type and on the memory side of the solver arrays
 template<typename real>
-VolumeSolverBase<real>::VolumeSolverBase()
+bool get_solver_view(VolumeAccess<real, DataInterpretationLayered> *view, const VolumeAccess<real, DataInterpretationLayered> &f, const BaseVolume *volume)
+{
+	VolumeUntypedAccess<DataInterpretationLayered> volume_view;
+	if (!volume->get_layered_view(&volume_view) || volume_view.elem_kind() != ElemType2Kind<real>::value ||
+		volume_view.is_on_host() != f.is_on_host() || volume_view.dim() != f.dim())
+	{
+		return false;
+	}
+	*view = volume_view.get_access<real>();
+	return true;
+}
+template<typename TVolumeAccess>
+bool get_solver_view(TVolumeAccess *view, const TVolumeAccess &f, const BaseVolume *volume)
+{
+	return false;
+}
+
+} // namespace
+
+
+
+template<typename real, typename DataInterpretation>
+VolumeSolverBase<real, DataInterpretation>::VolumeSolverBase()
 {
 	engine = NULL;
 	u_is_computed = false;
+	last_change = real(0);
+	last_change_iteration = -1;
 }
 
 
-template<typename real>
-VolumeSolverBase<real>::~VolumeSolverBase()
+template<typename real, typename DataInterpretation>
+VolumeSolverBase<real, DataInterpretation>::~VolumeSolverBase()
 {
 }
 
 
-template<typename real>
-void VolumeSolverBase<real>::set_engine(Engine3<real> *engine)
+template<typename real, typename DataInterpretation>
+void VolumeSolverBase<real, DataInterpretation>::set_engine(Engine3<real, DataInterpretation> *engine)
 {
 	this->engine = engine;
 }
 
 
-template<typename real>
-size_t VolumeSolverBase<real>::alloc(const ArrayDim3 &dim_u)
+template<typename real, typename DataInterpretation>
+size_t VolumeSolverBase<real, DataInterpretation>::alloc(const ArrayDim3 &dim_u)
 {
 	engine->alloc(dim_u);
 	const ArrayDim3 &dim_p = pd_vars.linear_operator.dim_range(dim_u);
@@ -55,36 +112,68 @@ size_t VolumeSolverBase<real>::alloc(const ArrayDim3 &dim_u)
 }
 
 
-template<typename real>
-void VolumeSolverBase<real>::free()
+template<typename real, typename DataInterpretation>
+size_t VolumeSolverBase<real, DataInterpretation>::estimate_memory(const ArrayDim3 &dim_u, const Par3 &par)
+{
+	// the arrays of Arrays::alloc
+	typename Engine3<real, DataInterpretation>::volume_manager_base_t *volume_manager = engine->volume_manager();
+	const ArrayDim3 &dim_p = pd_vars.linear_operator.dim_range(dim_u);
+	const ArrayDim3 dim_scalar(dim_u.w, dim_u.h, dim_u.d, 1);
+	size_t mem = 5 * volume_manager->alloc_size(dim_u) + volume_manager->alloc_size(dim_p) + 2 * volume_manager->alloc_size(dim_scalar);
+
+	// not on the host: a temporary device copy of the input (or the result) for the conversion from (or to) other volume types
+	if (!volume_manager->is_on_host())
+	{
+		mem += volume_manager->alloc_size(dim_u);
+	}
+	return mem;
+}
+
+
+template<typename real, typename DataInterpretation>
+void VolumeSolverBase<real, DataInterpretation>::reserve(const ArrayDim3 &dim_u, const Par3 &par_const)
+{
+	if (!engine->is_valid()) { return; }
+	this->par = par_const;
+	alloc(dim_u);
+}
+
+
+template<typename real, typename DataInterpretation>
+void VolumeSolverBase<real, DataInterpretation>::free()
 {
 	arr.free(engine);
 	engine->free();
 }
 
 
-template<typename real>
-void VolumeSolverBase<real>::init(const BaseVolume *volume)
+template<typename real, typename DataInterpretation>
+void VolumeSolverBase<real, DataInterpretation>::init(const BaseVolume *volume)
 {
-	volume->copy_to_layered(arr.f.get_untyped_access());
+	// use the input directly if possible, without copying it to arr.f
+	if (!get_solver_view(&f_in, arr.f, volume))
+	{
+		copy_to_solver_layout(arr.f.get_untyped_access(), volume);
+		f_in = arr.f;
+	}
 	if (par.temporal == real(0)) { u_is_computed = false; }
 	if (u_is_computed)
 	{
 		engine->volume_manager()->copy_from_samekind(arr.prev_u, arr.u);
 	}
-	engine->volume_manager()->copy_from_samekind(arr.u, arr.f);
+	engine->volume_manager()->copy_from_samekind(arr.u, f_in);
 	engine->volume_manager()->copy_from_samekind(arr.ubar, arr.u);
 	engine->volume_manager()->setzero(arr.p);
     if (par.weight)
     {
-	    set_regularizer_weight_from(arr.f);
+	    set_regularizer_weight_from(f_in);
     }
-    pd_vars.init(par, arr.f, arr.regularizer_weight, (u_is_computed? arr.prev_u : volume_access_t()));
+    pd_vars.init(par, f_in, arr.regularizer_weight, (u_is_computed? arr.prev_u : volume_access_t()));
 }
 
 
-template<typename real>
-void VolumeSolverBase<real>::set_regularizer_weight_from(volume_access_t volume)
+template<typename real, typename DataInterpretation>
+void VolumeSolverBase<real, DataInterpretation>::set_regularizer_weight_from(volume_access_t volume)
 {
 	linear_operator_t linear_operator;
 	const Dim3D &dim3d = volume.dim().dim3d();
@@ -98,8 +187,8 @@ void VolumeSolverBase<real>::set_regularizer_weight_from(volume_access_t volume)
 }
 
 
-template<typename real>
-real VolumeSolverBase<real>::energy()
+template<typename real, typename DataInterpretation>
+real VolumeSolverBase<real, DataInterpretation>::energy()
 {
 	engine->energy_base(arr.u, arr.aux_reduce, pd_vars.linear_operator, pd_vars.dataterm, pd_vars.regularizer);
 	real energy = engine->get_sum(arr.aux_reduce);
@@ -109,8 +198,8 @@ real VolumeSolverBase<real>::energy()
 }
 
 
-template<typename real>
-real VolumeSolverBase<real>::diff_l1(volume_access_t a, volume_access_t b)
+template<typename real, typename DataInterpretation>
+real VolumeSolverBase<real, DataInterpretation>::diff_l1(volume_access_t a, volume_access_t b)
 {
 	engine->diff_l1_base(a, b, arr.aux_reduce);
 	real diff = engine->get_sum(arr.aux_reduce);
@@ -118,34 +207,58 @@ real VolumeSolverBase<real>::diff_l1(volume_access_t a, volume_access_t b)
 	diff /= (size_t)dim3d.w * dim3d.h;
 	return diff;
 }
-template<typename real>
-bool VolumeSolverBase<real>::is_converged(int iteration)
+template<typename real, typename DataInterpretation>
+bool VolumeSolverBase<real, DataInterpretation>::is_converged(int iteration)
 {
 	if (par.stop_k <= 0 || (iteration + 1) % par.stop_k != 0)
 	{
 		return false;
 	}
 	real diff_to_prev = diff_l1(arr.u, arr.ubar) / pd_vars.theta_bar;
+	last_change = diff_to_prev;
+	last_change_iteration = iteration;
 	return (diff_to_prev <= par.stop_eps);
 }
 
 
-template<typename real>
-BaseVolume* VolumeSolverBase<real>::get_solution(const BaseVolume *volume)
+template<typename real, typename DataInterpretation>
+bool VolumeSolverBase<real, DataInterpretation>::is_cancelled(int iteration)
+{
+	if (!par.progress_callback || par.progress_k <= 0 || (iteration + 1) % par.progress_k != 0)
+	{
+		return false;
+	}
+	ProgressInfo info;
+	info.iteration = iteration + 1;
+	info.change = (last_change_iteration == iteration? last_change : diff_l1(arr.u, arr.ubar) / pd_vars.theta_bar);
+	info.u = (types_equal<DataInterpretation, DataInterpretationLayered>::value? arr.u.const_data() : NULL);  // other layouts: no view
+	info.u_is_double = (sizeof(real) == sizeof(double));
+	info.u_is_on_host = arr.u.is_on_host();
+	info.u_pitch = arr.u.data_pitch();
+	info.w = arr.u.dim().w;
+	info.h = arr.u.dim().h;
+	info.d = arr.u.dim().d;
+	info.num_channels = arr.u.dim().num_channels;
+	engine->synchronize();
+	stats.cancelled = !par.progress_callback(info, par.progress_user_data);
+	return stats.cancelled;
+}
+
+
+template<typename real, typename DataInterpretation>
+void VolumeSolverBase<real, DataInterpretation>::copy_solution(BaseVolume *out_volume)
 {
 	engine->volume_manager()->copy_from_samekind(arr.aux_result, arr.u);
 	if (par.edges)
 	{
 		engine->add_edges(arr.aux_result, pd_vars.linear_operator, pd_vars.regularizer);
 	}
-    BaseVolume* out_volume = volume->new_of_same_type_and_size();
-	out_volume->copy_from_layered(arr.aux_result.get_untyped_access());
-    return out_volume;
+	copy_from_solver_layout(out_volume, arr.aux_result.get_untyped_access());
 }
 
 
-template<typename real>
-void VolumeSolverBase<real>::print_stats()
+template<typename real, typename DataInterpretation>
+void VolumeSolverBase<real, DataInterpretation>::print_stats()
 {
 	if (stats.mem > 0)
 	{
@@ -160,7 +273,11 @@ void VolumeSolverBase<real>::print_stats()
 	{
 		snprintf(buffer, sizeof(buffer), ", average %2.4f s / %2.4f s (+ %2.4f)", stats.time_compute_sum / stats.num_runs, stats.time_sum / stats.num_runs, (stats.time_sum - stats.time_compute_sum) / stats.num_runs); std::cout << buffer;
 	}
-	if (stats.stop_iteration != -1)
+	if (stats.cancelled)
+	{
+		std::cout << ", " << (stats.stop_iteration + 1) << " iterations (cancelled)";
+	}
+	else if (stats.stop_iteration != -1)
 	{
 		std::cout << ", " << (stats.stop_iteration + 1) << " iterations";
 	}
@@ -180,16 +297,35 @@ void VolumeSolverBase<real>::print_stats()
 	{
 		std::cout << ", weighting";
 	}
+	if (stats.active_fraction > 0.0)
+	{
+		snprintf(buffer, sizeof(buffer), ", %2.1f%% active bricks", stats.active_fraction * 100.0); std::cout << buffer;
+	}
 	std::cout << ", energy ";
 	snprintf(buffer, sizeof(buffer), "%4.4f", stats.energy); std::cout << buffer;
 	std::cout << std::endl;
 }
 
 
-template<typename real>
-BaseVolume* VolumeSolverBase<real>::run(const BaseVolume *volume, const Par3 &par_const)
+template<typename real, typename DataInterpretation>
+BaseVolume* VolumeSolverBase<real, DataInterpretation>::run(const BaseVolume *volume, const Par3 &par_const)
+{
+	BaseVolume *out_volume = volume->new_of_same_type_and_size();
+	if (!engine->is_valid()) { return out_volume; }
+	run_into(out_volume, volume, par_const);
+	return out_volume;
+}
+
+
+template<typename real, typename DataInterpretation>
+void VolumeSolverBase<real, DataInterpretation>::run_into(BaseVolume *out_volume, const BaseVolume *volume, const Par3 &par_const)
 {
-	if (!engine->is_valid()) { BaseVolume *out_volume = volume->new_of_same_type_and_size(); return out_volume; }
+	if (!engine->is_valid()) { return; }
+	if (out_volume->dim() != volume->dim())
+	{
+		std::cerr << "ERROR: VolumeSolverBase::run_into(): Output size " << out_volume->dim() << " differs from input size " << volume->dim() << ", nothing computed" << std::endl;
+		return;
+	}
 	Timer timer_all;
 	timer_all.start();
 
@@ -207,32 +343,63 @@ BaseVolume* VolumeSolverBase<real>::run(const BaseVolume *volume, const Par3 &pa
 	// compute
 	engine->timer_start();
     stats.stop_iteration = -1;
+    stats.cancelled = false;
+    last_change_iteration = -1;
+    const bool sparse = (par.sparse && engine->has_sparse_step());
+    const int num_bricks = BrickGrid3(stats.dim_u.dim3d()).num_bricks();
+    double active_sum = 0.0;
+    int num_active = num_bricks;
+    int num_sparse_steps = 0;
+    bool sparse_is_faster = true;
     for (int iteration = 0; iteration < par.iterations; iteration++)
     {
     	pd_vars.update_vars();
-		if (iteration == 1200) std::cout << "here" << std::endl;
-    	engine->run_dual_p(arr.p, arr.ubar, pd_vars.linear_operator, pd_vars.regularizer, pd_vars.dt_d);
-    	engine->run_prim_u(arr.u, arr.ubar, arr.p, pd_vars.linear_operator, pd_vars.dataterm, pd_vars.theta_bar, pd_vars.dt_p);
+    	if (sparse && iteration % Engine3<real, DataInterpretation>::sparse_update_k == 0)
+    	{
+    		num_active = engine->update_active_bricks(arr.u, arr.ubar, arr.p, pd_vars.dataterm, iteration == 0);
+    		sparse_is_faster = (!engine->has_fused_step() || 100.0 * num_active <= (double)Engine3<real, DataInterpretation>::sparse_max_active_percent * num_bricks);
+    	}
+    	if (sparse)
+    	{
+    		active_sum += num_active;
+    		num_sparse_steps++;
+    	}
+    	if (sparse && sparse_is_faster)
+    	{
+    		engine->run_sparse_step(arr.p, arr.u, arr.ubar, pd_vars.linear_operator, pd_vars.regularizer, pd_vars.dataterm, pd_vars.dt_d, pd_vars.theta_bar, pd_vars.dt_p);
+    	}
+    	else if (engine->has_fused_step())
+    	{
+    		engine->run_fused_step(arr.p, arr.u, arr.ubar, pd_vars.linear_operator, pd_vars.regularizer, pd_vars.dataterm, pd_vars.dt_d, pd_vars.theta_bar, pd_vars.dt_p);
+    	}
+    	else
+    	{
+    		engine->run_dual_p(arr.p, arr.ubar, pd_vars.linear_operator, pd_vars.regularizer, pd_vars.dt_d);
+    		engine->run_prim_u(arr.u, arr.ubar, arr.p, pd_vars.linear_operator, pd_vars.dataterm, pd_vars.theta_bar, pd_vars.dt_p);
+    	}
     	if (is_converged(iteration)) { stats.stop_iteration = iteration; break; }
+    	if (is_cancelled(iteration)) { stats.stop_iteration = iteration; break; }
     }
     engine->timer_end();
-    u_is_computed = true;
+    stats.active_fraction = (num_sparse_steps > 0? active_sum / ((double)num_sparse_steps * num_bricks) : 0.0);
+    u_is_computed = !stats.cancelled;  // a cancelled solution is not used as the previous frame
     stats.time_compute = engine->timer_get();
     stats.time_compute_sum += stats.time_compute;
     stats.num_runs++;
     stats.energy = energy();
 
 
-    // get solution
-    BaseVolume *result = get_solution(volume);
+    // get solution, written directly into out_volume
+    copy_solution(out_volume);
     engine->synchronize();
     timer_all.end();
     stats.time = timer_all.get();
     stats.time_sum += stats.time;
     if (par.verbose) { print_stats(); }
-    return result;
 }
 
 
 template class VolumeSolverBase<float>;
 template class VolumeSolverBase<double>;
+template class VolumeSolverBase<float, DataInterpretationBricked>;
+template class VolumeSolverBase<double, DataInterpretationBricked>;
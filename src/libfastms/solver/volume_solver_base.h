@@ -25,11 +25,12 @@
 
 
 
-template<typename real>
+// The arrays are stored in the layout DataInterpretation: DataInterpretationLayered, or DataInterpretationBricked (host only).
+template<typename real, typename DataInterpretation = DataInterpretationLayered>
 class Engine3
 {
 public:
-	typedef VolumeAccess<real, DataInterpretationLayered> volume_access_t;
+	typedef VolumeAccess<real, DataInterpretation> volume_access_t;
 	typedef typename volume_access_t::data_interpretation_t data_interpretation_t;
 	typedef LinearOperator3<real> linear_operator_t;
 	typedef Regularizer3<volume_access_t> regularizer_t;
@@ -55,10 +56,29 @@ public:
 	virtual void set_regularizer_weight_from__normgrad(volume_access_t regularizer_weight, volume_access_t volume, linear_operator_t linear_operator) = 0;
 	virtual void set_regularizer_weight_from__exp(volume_access_t regularizer_weight, real coeff) = 0;
 	virtual void diff_l1_base(volume_access_t a, volume_access_t b, volume_access_t aux_reduce) = 0;
+
+	// Optional: run_dual_p(p, ubar) followed by run_prim_u(u, ubar, p) in one pass over the volume.
+	// Engines without it return false in has_fused_step().
+	virtual bool has_fused_step() { return false; }
+	virtual void run_fused_step(volume_access_t p, volume_access_t u, volume_access_t ubar, linear_operator_t linear_operator, regularizer_t regularizer,
+			dataterm_t dataterm, real dt_d, real theta_bar, real dt_p) {}
+
+	// Optional: the step on the active bricks (BrickGrid3) only. A brick is pinned, i.e. not active, if in it and in all its neighbor bricks
+	// u = ubar = f (= prev_u with the temporal term) is one and the same constant and p = 0: this is a fixed point of the iteration, for any step sizes.
+	// Changes travel one voxel per step, so update_active_bricks() must be called at least every sparse_update_k steps (reset = true on the first).
+	// It returns the number of active bricks. Engines without it return false in has_sparse_step().
+	static const int sparse_update_k = DataInterpretationBricked::brick_size;
+	// With more active bricks than this (in percent), the fused step over the whole volume is faster than the sparse step (measured break-even),
+	// and is used instead until the next update. The fused step leaves the pinned bricks as they are, so the result is the same.
+	static const int sparse_max_active_percent = 50;
+	virtual bool has_sparse_step() { return false; }
+	virtual int update_active_bricks(volume_access_t u, volume_access_t ubar, volume_access_t p, dataterm_t dataterm, bool reset) { return 0; }
+	virtual void run_sparse_step(volume_access_t p, volume_access_t u, volume_access_t ubar, linear_operator_t linear_operator, regularizer_t regularizer,
+			dataterm_t dataterm, real dt_d, real theta_bar, real dt_p) {}
 };
 
 
-template<typename real>
+template<typename real, typename DataInterpretation = DataInterpretationLayered>
 class VolumeSolverBase
 {
 public:
@@ -67,32 +87,43 @@ public:
 
 
 	BaseVolume* run(const BaseVolume *volume, const Par3 &par_const);
+	void run_into(BaseVolume *out_volume, const BaseVolume *volume, const Par3 &par_const);
+	size_t estimate_memory(const ArrayDim3 &dim_u, const Par3 &par);
+	void reserve(const ArrayDim3 &dim_u, const Par3 &par_const);
 
 protected:
-	void set_engine(Engine3<real> *engine);
+	void set_engine(Engine3<real, DataInterpretation> *engine);
+	void free();
 
 private:
-	typedef typename Engine3<real>::volume_access_t volume_access_t;
-	typedef typename Engine3<real>::linear_operator_t linear_operator_t;
+	typedef typename Engine3<real, DataInterpretation>::volume_access_t volume_access_t;
+	typedef typename Engine3<real, DataInterpretation>::linear_operator_t linear_operator_t;
 
 	size_t alloc(const ArrayDim3 &dim_u);
-	void free();
 	void init(const BaseVolume *volume);
 	void set_regularizer_weight_from(volume_access_t volume);
 	real energy();
 	real diff_l1(volume_access_t a, volume_access_t b);
 	bool is_converged(int iteration);
+	bool is_cancelled(int iteration);
 	void print_stats();
-	BaseVolume* get_solution(const BaseVolume *volume);
+	void copy_solution(BaseVolume *out_volume);
 
-	Engine3<real> *engine;
+	Engine3<real, DataInterpretation> *engine;
 	Par3 par;
 	PrimalDualVars3<volume_access_t> pd_vars;
 	bool u_is_computed;
 
+	// last computed value of the stopping criterion, for the progress callback
+	real last_change;
+	int last_change_iteration;
+
+	// the input f of the current run: the caller's data if it has the layout and elem type of arr.f, otherwise arr.f
+	volume_access_t f_in;
+
 	struct Arrays
 	{
-		size_t alloc(Engine3<real> *engine, const ArrayDim3 &dim_u, const ArrayDim3 &dim_p)
+		size_t alloc(Engine3<real, DataInterpretation> *engine, const ArrayDim3 &dim_u, const ArrayDim3 &dim_p)
 		{
 			// TODO: MULTICHANNEL
 			ArrayDim3 dim_scalar(dim_u.w, dim_u.h, dim_u.d, 1);
@@ -107,7 +138,7 @@ private:
 			mem += engine->volume_manager()->alloc(aux_reduce, dim_scalar);
 			return mem;
 		}
-		void free(Engine3<real> *engine)
+		void free(Engine3<real, DataInterpretation> *engine)
 		{
 			engine->volume_manager()->free(u);
 			engine->volume_manager()->free(ubar);
@@ -140,6 +171,8 @@ private:
 			time_sum = 0.0;
 			num_runs = 0;
 			energy = real(0);
+			cancelled = false;
+			active_fraction = 0.0;
 		}
 		ArrayDim3 dim_u;
 		ArrayDim3 dim_p;
@@ -151,6 +184,8 @@ private:
 		double time_sum;          // accumulation for averaging
 		int num_runs;
 		real energy;
+		bool cancelled;
+		double active_fraction;   // sparse iteration: average fraction of active bricks per step
 	} stats;
 };
 
@@ -89,8 +89,8 @@ public:
 			real p2_0 = (y + 1 < dim3d.h? p.get(x, y, z, 1 + 3 * i) : real(0));
 			real p2_y = (y > 0? p.get(x, y - 1, z, 1 + 3 * i) : real(0));
 			
-			real p3_0 = (z > 0? p.get(x, y, z, 2 + 3 * i) : real(0));
-			real p3_z = (z > 0? p.get(x, y - 1, z - 1, 2 + 3 * i) : real(0));
+			real p3_0 = (z + 1 < dim3d.d? p.get(x, y, z, 2 + 3 * i) : real(0));
+			real p3_z = (z > 0? p.get(x, y, z - 1, 2 + 3 * i) : real(0));
 			real val = p1_x - p1_0 + p2_y - p2_0  + p3_z - p3_0;
 			u.get(i) = val;
 		}
@@ -126,18 +126,21 @@ public:
     	return prev_u.is_valid() && (temporal > real(0) || temporal < real(0));
     }
 
+	// arg min_u  (u - u0)^2 / (2 * dt)  +  coeff * (u - f0)^2
+	HOST_DEVICE real prox_quadratic(real u0, real f0, real dt)
+	{
+		real c0 = get_coeff();
+		return f0 + (u0 - f0) / (real(1) + real(2) * dt * c0);
+	}
+
 	template<typename Array1D>
 	HOST_DEVICE void prox (Array1D &u, real dt, int x, int y, int z, const Dim3D &dim3d, const int u_num_channels)
 	{
-		// arg min_u  (u - u0)^2 / (2 * dt)  +  coeff * (u - f)^2
 		real c0 = get_coeff();
 
 		for(int i = 0; i < u_num_channels; i++)
 		{
-			real f0 = f.get(x, y, z, i);
-			real u0 = u.get(i);
-			u0 = f0 + (u0 - f0) / (real(1) + real(2) * dt * c0);
-			u.get(i) = u0;
+			u.get(i) = prox_quadratic(u.get(i), f.get(x, y, z, i), dt);
 		}
 		//TODO: Temporal support
 		if (has_temporal())
@@ -218,12 +221,18 @@ public:
 	HOST_DEVICE void prox_star(Array1D &p, real dt, int x, int y, int z, const Dim3D &dim3d, const int p_num_channels)
 	{
 		real weight0 = (weight.is_valid()? weight.get(x, y, z, 0) : real(1));
-		// min(alpha * |g|^2, lambda * weight)
 		real nrm2 = vec_norm_squared(p, p_num_channels);
+		real mult = prox_star_mult(nrm2, dt, weight0);
+    	vec_scale_eq (p, p_num_channels, mult);
+	}
+
+	// the factor by which prox_star scales p, given |p|^2
+	HOST_DEVICE real prox_star_mult(real nrm2, real dt, real weight0)
+	{
+		// min(alpha * |g|^2, lambda * weight)
 		real A = (alpha >= 0 && alpha < realmax<real>()? real(2) * alpha / (dt + real(2) * alpha) : real(1));
 		real L = (lambda >= 0 && lambda < realmax<real>()? real(2) * dt * lambda * weight0 : realmax<real>());
-		real mult = (nrm2 * A <= L? A : real(0));
-    	vec_scale_eq (p, p_num_channels, mult);
+		return (nrm2 * A <= L? A : real(0));
 	}
 
 	template<typename Array1D>
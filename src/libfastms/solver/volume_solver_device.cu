@@ -377,6 +377,7 @@ class VolumeSolverDeviceImplementation: public VolumeSolverBase<real>
 {
 public:
 	VolumeSolverDeviceImplementation() { VolumeSolverBase<real>::set_engine(&engine);	}
+	~VolumeSolverDeviceImplementation() { VolumeSolverBase<real>::free(); }  // while the engine still exists, returns the arrays to the MemPool
 private:
 	DeviceEngine3<real> engine;
 };
@@ -385,6 +386,9 @@ private:
 template<typename real> VolumeSolverDevice<real>::VolumeSolverDevice() : implementation(NULL) { implementation = new VolumeSolverDeviceImplementation<real>(); }
 template<typename real> VolumeSolverDevice<real>::~VolumeSolverDevice() { delete implementation; }
 template<typename real> BaseVolume* VolumeSolverDevice<real>::run(const BaseVolume *volume, const Par3 &par) { return implementation->run(volume, par); }
+template<typename real> void VolumeSolverDevice<real>::run_into(BaseVolume *out_volume, const BaseVolume *volume, const Par3 &par) { implementation->run_into(out_volume, volume, par); }
+template<typename real> size_t VolumeSolverDevice<real>::estimate_memory(const ArrayDim3 &dim, const Par3 &par) { return implementation->estimate_memory(dim, par); }
+template<typename real> void VolumeSolverDevice<real>::reserve(const ArrayDim3 &dim, const Par3 &par) { implementation->reserve(dim, par); }
 template class VolumeSolverDevice<float>;
 template class VolumeSolverDevice<double>;
 
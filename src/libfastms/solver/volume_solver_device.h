@@ -38,6 +38,9 @@ public:
 	~VolumeSolverDevice();
 
 	BaseVolume* run(const BaseVolume *volume, const Par3 &par);
+	void run_into(BaseVolume *out_volume, const BaseVolume *volume, const Par3 &par);
+	size_t estimate_memory(const ArrayDim3 &dim, const Par3 &par);
+	void reserve(const ArrayDim3 &dim, const Par3 &par);
 
 private:
 	VolumeSolverDevice(const VolumeSolverDevice<real> &other_solver);  // disable
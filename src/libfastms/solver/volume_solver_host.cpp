@@ -22,19 +22,46 @@
 #include "util/mem.h"
 #include "util/sum3.h"
 #include "util/timer.h"
+#include <algorithm>  // for std::min, std::max
+#include <vector>
 
 
 
-template<typename real>
-class HostEngine3: public Engine3<real>
+// Units of iteration and of parallel scheduling of the kernels: z-planes for the layered layout, bricks for the bricked layout
+template<typename DataInterpretation>
+struct HostBlocks3
+{
+	HostBlocks3(const Dim3D &dim3d) : dim3d(dim3d) {}
+	int num_blocks() const { return dim3d.d; }
+	void get_range(int b, int &x0, int &y0, int &z0, int &x1, int &y1, int &z1) const
+	{
+		x0 = 0; y0 = 0; z0 = b;
+		x1 = dim3d.w; y1 = dim3d.h; z1 = b + 1;
+	}
+	Dim3D dim3d;
+};
+
+template<>
+struct HostBlocks3<DataInterpretationBricked>
+{
+	HostBlocks3(const Dim3D &dim3d) : grid(dim3d) {}
+	int num_blocks() const { return grid.num_bricks(); }
+	void get_range(int b, int &x0, int &y0, int &z0, int &x1, int &y1, int &z1) const { grid.get_range(b, x0, y0, z0, x1, y1, z1); }
+	BrickGrid3 grid;
+};
+
+
+
+template<typename real, typename DataInterpretation>
+class HostEngine3: public Engine3<real, DataInterpretation>
 {
 public:
-	typedef Engine3<real> Base;
+	typedef Engine3<real, DataInterpretation> Base;
 	typedef typename Base::volume_access_t volume_access_t;
 	typedef typename Base::linear_operator_t linear_operator_t;
 	typedef typename Base::regularizer_t regularizer_t;
 	typedef typename Base::dataterm_t dataterm_t;
-	typedef HostAllocator3 allocator_t;
+	typedef HostPoolAllocator3 allocator_t;
 	typedef VolumeManager<real, typename volume_access_t::data_interpretation_t, allocator_t> volume_manager_t;
 
 	HostEngine3() {}
@@ -52,19 +79,42 @@ public:
 
 	virtual void run_dual_p(volume_access_t p, volume_access_t u, linear_operator_t linear_operator, regularizer_t regularizer, real dt);
 	virtual void run_prim_u(volume_access_t u, volume_access_t ubar, volume_access_t p, linear_operator_t linear_operator, dataterm_t dataterm, real theta_bar, real dt);
+	void run_dual_p_block(volume_access_t p, volume_access_t u, linear_operator_t &linear_operator, regularizer_t &regularizer, real dt,
+			int x0, int y0, int z0, int x1, int y1, int z1, HeapArray<real> &p_sh);
+	void run_prim_u_block(volume_access_t u, volume_access_t ubar, volume_access_t p, linear_operator_t &linear_operator, dataterm_t &dataterm,
+			real theta_bar, real dt, int x0, int y0, int z0, int x1, int y1, int z1, HeapArray<real> &u_sh, HeapArray<real> &valold_sh);
 	virtual void energy_base(volume_access_t u, volume_access_t aux_reduce, linear_operator_t linear_operator, dataterm_t dataterm, regularizer_t regularizer);
 	virtual void add_edges(volume_access_t cur_result, linear_operator_t linear_operator, regularizer_t regularizer);
 	virtual void set_regularizer_weight_from__normgrad(volume_access_t regularizer_weight, volume_access_t volume, linear_operator_t linear_operator);
 	virtual void set_regularizer_weight_from__exp(volume_access_t regularizer_weight, real coeff);
 	virtual void diff_l1_base(volume_access_t a, volume_access_t b, volume_access_t aux_reduce);
 
+	virtual bool has_fused_step() { return types_equal<DataInterpretation, DataInterpretationLayered>::value; }  // the z-stream needs whole planes
+	virtual void run_fused_step(volume_access_t p, volume_access_t u, volume_access_t ubar, linear_operator_t linear_operator, regularizer_t regularizer,
+			dataterm_t dataterm, real dt_d, real theta_bar, real dt_p);
+	void run_dual_p_rows(volume_access_t p, volume_access_t ubar, regularizer_t regularizer, real dt, int z, int y0, int y1, int x0, int x1, HeapArray<real> &nrm2);
+	void run_prim_u_rows(volume_access_t u, volume_access_t ubar, volume_access_t p, linear_operator_t linear_operator, dataterm_t dataterm,
+			real theta_bar, real dt, int z, int y0, int y1, int x0, int x1, HeapArray<real> &u_sh, HeapArray<real> &valold_sh);
+
+	virtual bool has_sparse_step() { return true; }
+	virtual int update_active_bricks(volume_access_t u, volume_access_t ubar, volume_access_t p, dataterm_t dataterm, bool reset);
+	virtual void run_sparse_step(volume_access_t p, volume_access_t u, volume_access_t ubar, linear_operator_t linear_operator, regularizer_t regularizer,
+			dataterm_t dataterm, real dt_d, real theta_bar, real dt_p);
+	bool is_quiet_brick(volume_access_t u, volume_access_t ubar, volume_access_t p, dataterm_t &dataterm, const BrickGrid3 &grid, int b, real *value);
+
 	volume_manager_t volume_manager_;
 	Timer timer;
+
+	// sparse step: per brick of the BrickGrid3
+	std::vector<int> active_bricks;
+	std::vector<unsigned char> brick_active;
+	std::vector<unsigned char> brick_quiet;
+	std::vector<real> brick_value;  // the constant of a quiet brick, for each channel
 };
 
 
-template<typename real>
-std::string HostEngine3<real>::str()
+template<typename real, typename DataInterpretation>
+std::string HostEngine3<real, DataInterpretation>::str()
 {
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
 	return "cpu with openmp";
@@ -74,25 +124,42 @@ std::string HostEngine3<real>::str()
 }
 
 
-template<typename real>
-void HostEngine3<real>::run_dual_p(volume_access_t p, volume_access_t u, linear_operator_t linear_operator, regularizer_t regularizer, real dt)
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::run_dual_p(volume_access_t p, volume_access_t u, linear_operator_t linear_operator, regularizer_t regularizer, real dt)
 {
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
     #pragma omp parallel default(none) firstprivate(p, u, linear_operator, regularizer, dt)
 	{
 #endif
-	const Dim3D &dim3d = u.dim().dim3d();
-	const int u_num_channels = u.dim().num_channels;
-	const int p_num_channels = linear_operator.num_channels_range(u_num_channels);
-	HeapArray<real> p_sh(p_num_channels);
+	const HostBlocks3<DataInterpretation> blocks(u.dim().dim3d());
+	HeapArray<real> p_sh(linear_operator.num_channels_range(u.dim().num_channels));
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
     #pragma omp for
 #endif
-	for (int z = 0; z < dim3d.d; z++)
+    for (int block = 0; block < blocks.num_blocks(); block++)
     {
-        for (int y = 0; y < dim3d.h; y++)
+        int x0, y0, z0, x1, y1, z1;
+        blocks.get_range(block, x0, y0, z0, x1, y1, z1);
+        run_dual_p_block(p, u, linear_operator, regularizer, dt, x0, y0, z0, x1, y1, z1, p_sh);
+    }
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	}
+#endif
+}
+
+
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::run_dual_p_block(volume_access_t p, volume_access_t u, linear_operator_t &linear_operator, regularizer_t &regularizer, real dt,
+		int x0, int y0, int z0, int x1, int y1, int z1, HeapArray<real> &p_sh)
+{
+	const Dim3D &dim3d = u.dim().dim3d();
+	const int u_num_channels = u.dim().num_channels;
+	const int p_num_channels = linear_operator.num_channels_range(u_num_channels);
+    for (int z = z0; z < z1; z++)
+    {
+        for (int y = y0; y < y1; y++)
         {
-            for (int x = 0; x < dim3d.w; x++)
+            for (int x = x0; x < x1; x++)
             {
                 linear_operator.apply(p_sh, u, x, y, z, dim3d, u_num_channels);
 
@@ -110,31 +177,45 @@ void HostEngine3<real>::run_dual_p(volume_access_t p, volume_access_t u, linear_
             }
     	}
     }
-#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
-	}
-#endif
 }
 
 
-template<typename real>
-void HostEngine3<real>::run_prim_u(volume_access_t u, volume_access_t ubar, volume_access_t p, linear_operator_t linear_operator, dataterm_t dataterm, real theta_bar, real dt)
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::run_prim_u(volume_access_t u, volume_access_t ubar, volume_access_t p, linear_operator_t linear_operator, dataterm_t dataterm, real theta_bar, real dt)
 {
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
     #pragma omp parallel default(none) firstprivate(u, ubar, p, linear_operator, dataterm, theta_bar, dt)
 	{
 #endif
-	const Dim3D &dim3d = u.dim().dim3d();
-	const int u_num_channels = u.dim().num_channels;
-	HeapArray<real> u_sh(u_num_channels);
-	HeapArray<real> valold_sh(u_num_channels);
+	const HostBlocks3<DataInterpretation> blocks(u.dim().dim3d());
+	HeapArray<real> u_sh(u.dim().num_channels);
+	HeapArray<real> valold_sh(u.dim().num_channels);
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
     #pragma omp for
 #endif
-    for (int z = 0; z < dim3d.d; z++)
+    for (int block = 0; block < blocks.num_blocks(); block++)
     {
-        for (int y = 0; y < dim3d.h; y++)
+        int x0, y0, z0, x1, y1, z1;
+        blocks.get_range(block, x0, y0, z0, x1, y1, z1);
+        run_prim_u_block(u, ubar, p, linear_operator, dataterm, theta_bar, dt, x0, y0, z0, x1, y1, z1, u_sh, valold_sh);
+    }
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	}
+#endif
+}
+
+
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::run_prim_u_block(volume_access_t u, volume_access_t ubar, volume_access_t p, linear_operator_t &linear_operator, dataterm_t &dataterm,
+		real theta_bar, real dt, int x0, int y0, int z0, int x1, int y1, int z1, HeapArray<real> &u_sh, HeapArray<real> &valold_sh)
+{
+	const Dim3D &dim3d = u.dim().dim3d();
+	const int u_num_channels = u.dim().num_channels;
+    for (int z = z0; z < z1; z++)
+    {
+        for (int y = y0; y < y1; y++)
         {
-            for (int x = 0; x < dim3d.w; x++)
+            for (int x = x0; x < x1; x++)
             {
                 linear_operator.apply_transpose(u_sh, p, x, y, z, dim3d, u_num_channels);
 
@@ -157,14 +238,303 @@ void HostEngine3<real>::run_prim_u(volume_access_t u, volume_access_t ubar, volu
             }
         }
     }
+}
+
+
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::run_fused_step(volume_access_t p, volume_access_t u, volume_access_t ubar, linear_operator_t linear_operator, regularizer_t regularizer,
+		dataterm_t dataterm, real dt_d, real theta_bar, real dt_p)
+{
+	// 2.5D blocking: Instead of two sweeps over the whole volume, one sweep along z, where step k runs the dual step on plane k
+	// and the primal step on plane k - 1. The primal step on plane k - 1 needs p of the planes k - 1 and k - 2, computed in the previous steps,
+	// and the dual step on plane k reads ubar of the planes k and k + 1, not yet changed by the primal step. So only a window of
+	// about three planes is touched per step and stays in the cache, instead of streaming the whole volume twice per iteration.
+	// Each plane is split into bands of rows, distributed over the threads in the same way in every step.
+	const Dim3D dim3d = u.dim().dim3d();
+	const int u_num_channels = u.dim().num_channels;
+	const size_t row_bytes = (size_t)dim3d.w * sizeof(real) * (8 * u_num_channels + 2);  // u, ubar, f, p in the window
+	const int band = std::max(1, std::min((int)dim3d.h, (int)((256 * 1024) / row_bytes)));
+	const int num_bands = (dim3d.h + band - 1) / band;
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel default(none) firstprivate(p, u, ubar, linear_operator, regularizer, dataterm, dt_d, theta_bar, dt_p, dim3d, u_num_channels, band, num_bands)
+	{
+#endif
+	HeapArray<real> nrm2(dim3d.w);
+	HeapArray<real> u_sh(u_num_channels);
+	HeapArray<real> valold_sh(u_num_channels);
+	for (int k = 0; k <= dim3d.d; k++)
+	{
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	    #pragma omp for schedule(static)
+#endif
+		for (int b = 0; b < num_bands; b++)
+		{
+			const int y0 = b * band;
+			const int y1 = std::min(y0 + band, (int)dim3d.h);
+			if (k < dim3d.d) { run_dual_p_rows(p, ubar, regularizer, dt_d, k, y0, y1, 0, dim3d.w, nrm2); }
+			if (k > 0) { run_prim_u_rows(u, ubar, p, linear_operator, dataterm, theta_bar, dt_p, k - 1, y0, y1, 0, dim3d.w, u_sh, valold_sh); }
+		}
+	}
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	}
+#endif
+}
+
+
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::run_dual_p_rows(volume_access_t p, volume_access_t ubar, regularizer_t regularizer, real dt, int z, int y0, int y1, int x0, int x1, HeapArray<real> &nrm2)
+{
+	// run_dual_p() for x0 <= x < x1 in the rows y0 <= y < y1 of plane z, channel by channel along the (contiguous) rows of the layered layout
+	const Dim3D dim3d = ubar.dim().dim3d();
+	const int u_num_channels = ubar.dim().num_channels;
+	const int w = dim3d.w;
+	const int x1_px = std::min(x1, w - 1);  // forward difference in x is 0 at the border
+	for (int y = y0; y < y1; y++)
+	{
+		for (int x = x0; x < x1; x++) { nrm2.get(x) = real(0); }
+		for (int i = 0; i < u_num_channels; i++)
+		{
+			const real *u_row = &ubar.get(0, y, z, i);
+			real *px = &p.get(0, y, z, 3 * i);
+			real *py = &p.get(0, y, z, 3 * i + 1);
+			real *pz = &p.get(0, y, z, 3 * i + 2);
+			for (int x = x0; x < x1_px; x++) { px[x] += (u_row[x + 1] - u_row[x]) * dt; }
+			if (y + 1 < dim3d.h)
+			{
+				const real *u_next = &ubar.get(0, y + 1, z, i);
+				for (int x = x0; x < x1; x++) { py[x] += (u_next[x] - u_row[x]) * dt; }
+			}
+			if (z + 1 < dim3d.d)
+			{
+				const real *u_next = &ubar.get(0, y, z + 1, i);
+				for (int x = x0; x < x1; x++) { pz[x] += (u_next[x] - u_row[x]) * dt; }
+			}
+			for (int x = x0; x < x1; x++) { nrm2.get(x) += px[x] * px[x] + py[x] * py[x] + pz[x] * pz[x]; }
+		}
+		for (int x = x0; x < x1; x++)
+		{
+			real weight0 = (regularizer.weight.is_valid()? regularizer.weight.get(x, y, z, 0) : real(1));
+			nrm2.get(x) = regularizer.prox_star_mult(nrm2.get(x), dt, weight0);
+		}
+		for (int i = 0; i < 3 * u_num_channels; i++)
+		{
+			real *p_row = &p.get(0, y, z, i);
+			for (int x = x0; x < x1; x++) { p_row[x] *= nrm2.get(x); }
+		}
+	}
+}
+
+
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::run_prim_u_rows(volume_access_t u, volume_access_t ubar, volume_access_t p, linear_operator_t linear_operator, dataterm_t dataterm,
+		real theta_bar, real dt, int z, int y0, int y1, int x0, int x1, HeapArray<real> &u_sh, HeapArray<real> &valold_sh)
+{
+	// run_prim_u() for x0 <= x < x1 in the rows y0 <= y < y1 of plane z
+	const Dim3D dim3d = u.dim().dim3d();
+	const int u_num_channels = u.dim().num_channels;
+	const int w = dim3d.w;
+	if (dataterm.has_temporal())
+	{
+		// the temporal term couples the channels: voxel by voxel
+		for (int y = y0; y < y1; y++)
+		{
+			for (int x = x0; x < x1; x++)
+			{
+				linear_operator.apply_transpose(u_sh, p, x, y, z, dim3d, u_num_channels);
+				for (int i = 0; i < u_num_channels; i++)
+				{
+					real valold = u.get(x, y, z, i);
+					u_sh.get(i) = valold - u_sh.get(i) * dt;
+					valold_sh.get(i) = valold;
+				}
+				dataterm.prox(u_sh, dt, x, y, z, dim3d, u_num_channels);
+				for (int i = 0; i < u_num_channels; i++)
+				{
+					u.get(x, y, z, i) = u_sh.get(i);
+					ubar.get(x, y, z, i) = u_sh.get(i) + (u_sh.get(i) - valold_sh.get(i)) * theta_bar;
+				}
+			}
+		}
+		return;
+	}
+	for (int y = y0; y < y1; y++)
+	{
+		for (int i = 0; i < u_num_channels; i++)
+		{
+			const real *px = &p.get(0, y, z, 3 * i);
+			const real *py = &p.get(0, y, z, 3 * i + 1);
+			const real *py_prev = (y > 0? &p.get(0, y - 1, z, 3 * i + 1) : NULL);
+			const real *pz = &p.get(0, y, z, 3 * i + 2);
+			const real *pz_prev = (z > 0? &p.get(0, y, z - 1, 3 * i + 2) : NULL);
+			const real *f_row = &dataterm.f.get(0, y, z, i);
+			real *u_row = &u.get(0, y, z, i);
+			real *ubar_row = &ubar.get(0, y, z, i);
+			const bool has_y = (y + 1 < dim3d.h);
+			const bool has_z = (z + 1 < dim3d.d);
+			for (int x = x0; x < x1; x++)
+			{
+				real p1_0 = (x + 1 < w? px[x] : real(0));
+				real p1_x = (x > 0? px[x - 1] : real(0));
+				real p2_0 = (has_y? py[x] : real(0));
+				real p2_y = (py_prev? py_prev[x] : real(0));
+				real p3_0 = (has_z? pz[x] : real(0));
+				real p3_z = (pz_prev? pz_prev[x] : real(0));
+				real valold = u_row[x];
+				real valnew = dataterm.prox_quadratic(valold - (p1_x - p1_0 + p2_y - p2_0 + p3_z - p3_0) * dt, f_row[x], dt);
+				u_row[x] = valnew;
+				ubar_row[x] = valnew + (valnew - valold) * theta_bar;
+			}
+		}
+	}
+}
+
+
+template<typename real, typename DataInterpretation>
+bool HostEngine3<real, DataInterpretation>::is_quiet_brick(volume_access_t u, volume_access_t ubar, volume_access_t p, dataterm_t &dataterm, const BrickGrid3 &grid, int b, real *value)
+{
+	const int u_num_channels = u.dim().num_channels;
+	const int p_num_channels = p.dim().num_channels;
+	const bool has_temporal = dataterm.has_temporal();
+	int x0, y0, z0, x1, y1, z1;
+	grid.get_range(b, x0, y0, z0, x1, y1, z1);
+	for (int i = 0; i < u_num_channels; i++) { value[i] = dataterm.f.get(x0, y0, z0, i); }
+    for (int z = z0; z < z1; z++)
+    {
+        for (int y = y0; y < y1; y++)
+        {
+            for (int x = x0; x < x1; x++)
+            {
+            	for (int i = 0; i < u_num_channels; i++)
+            	{
+            		const real c = value[i];
+            		if (dataterm.f.get(x, y, z, i) != c || u.get(x, y, z, i) != c || ubar.get(x, y, z, i) != c) { return false; }
+            		if (has_temporal && dataterm.prev_u.get(x, y, z, i) != c) { return false; }
+            	}
+            	for (int i = 0; i < p_num_channels; i++)
+            	{
+            		if (p.get(x, y, z, i) != real(0)) { return false; }
+            	}
+            }
+        }
+    }
+    return true;
+}
+
+
+template<typename real, typename DataInterpretation>
+int HostEngine3<real, DataInterpretation>::update_active_bricks(volume_access_t u, volume_access_t ubar, volume_access_t p, dataterm_t dataterm, bool reset)
+{
+	const BrickGrid3 grid(u.dim().dim3d());
+	const int num_bricks = grid.num_bricks();
+	const int u_num_channels = u.dim().num_channels;
+	if (reset || (int)brick_active.size() != num_bricks)
+	{
+		brick_active.assign(num_bricks, 1);
+		brick_quiet.assign(num_bricks, 0);
+		brick_value.assign((size_t)num_bricks * u_num_channels, real(0));
+	}
+
+	// pinned bricks have not changed and stay quiet, check only the active ones
+	active_bricks.clear();
+	for (int b = 0; b < num_bricks; b++) { if (brick_active[b]) { active_bricks.push_back(b); } }
+	const int num_checked = (int)active_bricks.size();
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel for schedule(dynamic, 16)
+#endif
+	for (int k = 0; k < num_checked; k++)
+	{
+		const int b = active_bricks[k];
+		brick_quiet[b] = is_quiet_brick(u, ubar, p, dataterm, grid, b, &brick_value[(size_t)b * u_num_channels]);
+	}
+
+	// a quiet brick is pinned if all its neighbor bricks are quiet with the same constant
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel for
+#endif
+	for (int b = 0; b < num_bricks; b++)
+	{
+		bool pinned = brick_quiet[b];
+		const int bx = b % grid.bw;
+		const int by = (b / grid.bw) % grid.bh;
+		const int bz = b / (grid.bw * grid.bh);
+		for (int nz = std::max(bz - 1, 0); pinned && nz <= std::min(bz + 1, grid.bd - 1); nz++)
+		{
+			for (int ny = std::max(by - 1, 0); pinned && ny <= std::min(by + 1, grid.bh - 1); ny++)
+			{
+				for (int nx = std::max(bx - 1, 0); pinned && nx <= std::min(bx + 1, grid.bw - 1); nx++)
+				{
+					const int nb = nx + grid.bw * (ny + grid.bh * nz);
+					pinned = brick_quiet[nb];
+					for (int i = 0; pinned && i < u_num_channels; i++) { pinned = (brick_value[(size_t)nb * u_num_channels + i] == brick_value[(size_t)b * u_num_channels + i]); }
+				}
+			}
+		}
+		brick_active[b] = !pinned;
+	}
+
+	active_bricks.clear();
+	for (int b = 0; b < num_bricks; b++) { if (brick_active[b]) { active_bricks.push_back(b); } }
+	return (int)active_bricks.size();
+}
+
+
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::run_sparse_step(volume_access_t p, volume_access_t u, volume_access_t ubar, linear_operator_t linear_operator, regularizer_t regularizer,
+		dataterm_t dataterm, real dt_d, real theta_bar, real dt_p)
+{
+	const BrickGrid3 grid(u.dim().dim3d());
+	const int num_active = (int)active_bricks.size();
+	const int *active = (num_active > 0? &active_bricks[0] : NULL);
+	const bool rows = types_equal<DataInterpretation, DataInterpretationLayered>::value;  // the row kernels need contiguous rows
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp parallel default(none) firstprivate(p, u, ubar, linear_operator, regularizer, dataterm, dt_d, theta_bar, dt_p, grid, num_active, active, rows)
+	{
+#endif
+	HeapArray<real> nrm2(u.dim().w);
+	HeapArray<real> p_sh(linear_operator.num_channels_range(u.dim().num_channels));
+	HeapArray<real> u_sh(u.dim().num_channels);
+	HeapArray<real> valold_sh(u.dim().num_channels);
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp for
+#endif
+    for (int k = 0; k < num_active; k++)
+    {
+        int x0, y0, z0, x1, y1, z1;
+        grid.get_range(active[k], x0, y0, z0, x1, y1, z1);
+        if (rows)
+        {
+        	for (int z = z0; z < z1; z++) { run_dual_p_rows(p, ubar, regularizer, dt_d, z, y0, y1, x0, x1, nrm2); }
+        }
+        else
+        {
+        	run_dual_p_block(p, ubar, linear_operator, regularizer, dt_d, x0, y0, z0, x1, y1, z1, p_sh);
+        }
+    }
+    // implicit barrier: the primal step needs p of the neighbor bricks
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+    #pragma omp for
+#endif
+    for (int k = 0; k < num_active; k++)
+    {
+        int x0, y0, z0, x1, y1, z1;
+        grid.get_range(active[k], x0, y0, z0, x1, y1, z1);
+        if (rows)
+        {
+        	for (int z = z0; z < z1; z++) { run_prim_u_rows(u, ubar, p, linear_operator, dataterm, theta_bar, dt_p, z, y0, y1, x0, x1, u_sh, valold_sh); }
+        }
+        else
+        {
+        	run_prim_u_block(u, ubar, p, linear_operator, dataterm, theta_bar, dt_p, x0, y0, z0, x1, y1, z1, u_sh, valold_sh);
+        }
+    }
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
 	}
 #endif
 }
 
 
-template<typename real>
-void HostEngine3<real>::energy_base(volume_access_t u, volume_access_t aux_reduce, linear_operator_t linear_operator, dataterm_t dataterm, regularizer_t regularizer)
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::energy_base(volume_access_t u, volume_access_t aux_reduce, linear_operator_t linear_operator, dataterm_t dataterm, regularizer_t regularizer)
 {
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
     #pragma omp parallel default(none) firstprivate(u, aux_reduce, linear_operator, dataterm, regularizer)
@@ -204,8 +574,8 @@ void HostEngine3<real>::energy_base(volume_access_t u, volume_access_t aux_reduc
 }
 
 
-template<typename real>
-void HostEngine3<real>::add_edges(volume_access_t volume, linear_operator_t linear_operator, regularizer_t regularizer)
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::add_edges(volume_access_t volume, linear_operator_t linear_operator, regularizer_t regularizer)
 {
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
     #pragma omp parallel default(none) firstprivate(volume, linear_operator, regularizer)
@@ -241,8 +611,8 @@ void HostEngine3<real>::add_edges(volume_access_t volume, linear_operator_t line
 }
 
 
-template<typename real>
-void HostEngine3<real>::set_regularizer_weight_from__normgrad(volume_access_t regularizer_weight, volume_access_t volume, linear_operator_t linear_operator)
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::set_regularizer_weight_from__normgrad(volume_access_t regularizer_weight, volume_access_t volume, linear_operator_t linear_operator)
 {
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
     #pragma omp parallel default(none) firstprivate(regularizer_weight, volume, linear_operator)
@@ -273,8 +643,8 @@ void HostEngine3<real>::set_regularizer_weight_from__normgrad(volume_access_t re
 }
 
 
-template<typename real>
-void HostEngine3<real>::set_regularizer_weight_from__exp(volume_access_t regularizer_weight, real coeff)
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::set_regularizer_weight_from__exp(volume_access_t regularizer_weight, real coeff)
 {
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
     #pragma omp parallel default(none) firstprivate(regularizer_weight, coeff)
@@ -301,8 +671,8 @@ void HostEngine3<real>::set_regularizer_weight_from__exp(volume_access_t regular
 }
 
 
-template<typename real>
-void HostEngine3<real>::diff_l1_base(volume_access_t a, volume_access_t b, volume_access_t aux_reduce)
+template<typename real, typename DataInterpretation>
+void HostEngine3<real, DataInterpretation>::diff_l1_base(volume_access_t a, volume_access_t b, volume_access_t aux_reduce)
 {
 #if !defined(DISABLE_OPENMP) && defined(_OPENMP)
     #pragma omp parallel firstprivate(a, b, aux_reduce)
@@ -338,19 +708,40 @@ void HostEngine3<real>::diff_l1_base(volume_access_t a, volume_access_t b, volum
 
 
 
-template<typename real>
-class VolumeSolverHostImplementation: public VolumeSolverBase<real>
+template<typename real, typename DataInterpretation>
+class VolumeSolverHostImplementation: public VolumeSolverBase<real, DataInterpretation>
 {
 public:
-	VolumeSolverHostImplementation() { VolumeSolverBase<real>::set_engine(&engine);	}
+	VolumeSolverHostImplementation() { VolumeSolverBase<real, DataInterpretation>::set_engine(&engine);	}
+	~VolumeSolverHostImplementation() { VolumeSolverBase<real, DataInterpretation>::free(); }  // while the engine still exists, returns the arrays to the MemPool
 private:
-	HostEngine3<real> engine;
+	HostEngine3<real, DataInterpretation> engine;
 };
 
 
-template<typename real> VolumeSolverHost<real>::VolumeSolverHost() : implementation(NULL) {	implementation = new VolumeSolverHostImplementation<real>(); }
-template<typename real> VolumeSolverHost<real>::~VolumeSolverHost() { delete implementation; }
-template<typename real> BaseVolume* VolumeSolverHost<real>::run(const BaseVolume *volume, const Par3 &par) { return implementation->run(volume, par); }
+template<typename real> VolumeSolverHost<real>::VolumeSolverHost() : implementation(NULL), implementation_bricked(NULL) {	implementation = new VolumeSolverHostImplementation<real, DataInterpretationLayered>(); }
+template<typename real> VolumeSolverHost<real>::~VolumeSolverHost() { delete implementation; delete implementation_bricked; }
+template<typename real> VolumeSolverHostImplementation<real, DataInterpretationBricked>* VolumeSolverHost<real>::bricked()
+{
+	if (!implementation_bricked) { implementation_bricked = new VolumeSolverHostImplementation<real, DataInterpretationBricked>(); }
+	return implementation_bricked;
+}
+template<typename real> BaseVolume* VolumeSolverHost<real>::run(const BaseVolume *volume, const Par3 &par)
+{
+	return (par.layout == Par3::layout_bricked? bricked()->run(volume, par) : implementation->run(volume, par));
+}
+template<typename real> void VolumeSolverHost<real>::run_into(BaseVolume *out_volume, const BaseVolume *volume, const Par3 &par)
+{
+	if (par.layout == Par3::layout_bricked) { bricked()->run_into(out_volume, volume, par); } else { implementation->run_into(out_volume, volume, par); }
+}
+template<typename real> size_t VolumeSolverHost<real>::estimate_memory(const ArrayDim3 &dim, const Par3 &par)
+{
+	return (par.layout == Par3::layout_bricked? bricked()->estimate_memory(dim, par) : implementation->estimate_memory(dim, par));
+}
+template<typename real> void VolumeSolverHost<real>::reserve(const ArrayDim3 &dim, const Par3 &par)
+{
+	if (par.layout == Par3::layout_bricked) { bricked()->reserve(dim, par); } else { implementation->reserve(dim, par); }
+}
 
 template class VolumeSolverHost<float>;
 template class VolumeSolverHost<double>;
@@ -23,7 +23,9 @@
 #include "volume_solver.h"
 
 
-template<typename real> class VolumeSolverHostImplementation;
+struct DataInterpretationLayered;
+struct DataInterpretationBricked;
+template<typename real, typename DataInterpretation> class VolumeSolverHostImplementation;
 
 template<typename real>
 class VolumeSolverHost
@@ -35,12 +37,17 @@ public:
 	~VolumeSolverHost();
 
 	BaseVolume* run(const BaseVolume *in_volume, const Par3 &par);
+	void run_into(BaseVolume *out_volume, const BaseVolume *in_volume, const Par3 &par);
+	size_t estimate_memory(const ArrayDim3 &dim, const Par3 &par);
+	void reserve(const ArrayDim3 &dim, const Par3 &par);
 
 private:
 	VolumeSolverHost(const VolumeSolverHost<real> &other_solver);  // disable
 	VolumeSolverHost<real>& operator= (const VolumeSolverHost<real> &other_solver);  // disable
+	VolumeSolverHostImplementation<real, DataInterpretationBricked>* bricked();
 
-	VolumeSolverHostImplementation<real> *implementation;
+	VolumeSolverHostImplementation<real, DataInterpretationLayered> *implementation;
+	VolumeSolverHostImplementation<real, DataInterpretationBricked> *implementation_bricked;  // created on first use with Par3::layout_bricked
 };
 
 
@@ -23,6 +23,7 @@
 #include "image_access.h"
 #include "image_access_convert.h"
 #include <iostream>
+#include <algorithm>  // for std::swap
 
 #ifndef DISABLE_CUDA
 #include <cuda_runtime.h>
@@ -38,12 +39,55 @@ class BaseImage
 public:
 	virtual ~BaseImage() {}
 	virtual BaseImage* new_of_same_type_and_size() const = 0;
+	virtual BaseImage* new_of_same_type(const ArrayDim &dim) const = 0;
 	virtual ArrayDim dim() const = 0;
 	virtual void copy_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in) = 0;
 	virtual void copy_to_layered(ImageUntypedAccess<DataInterpretationLayered> out) const = 0;
+
+	// If the data is stored in the layered layout (with any row pitch), sets view to it and returns true.
+	// The solver then reads its input directly from the view instead of copying it with copy_to_layered().
+	virtual bool get_layered_view(ImageUntypedAccess<DataInterpretationLayered> *view) const { return false; }
+
+	// Copy only the region at (x0, y0) with the size of out (resp. in), e.g. one tile of a large image. out and in must be on the host.
+	// The default implementations go through a full size copy of the image, unless get_layered_view() provides the data on the host.
+	virtual void copy_region_to_layered(ImageUntypedAccess<DataInterpretationLayered> out, int x0, int y0) const;
+	virtual void copy_region_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in, int x0, int y0);
 };
 
 
+inline void BaseImage::copy_region_to_layered(ImageUntypedAccess<DataInterpretationLayered> out, int x0, int y0) const
+{
+	ImageUntypedAccess<DataInterpretationLayered> full;
+	if (get_layered_view(&full) && full.is_on_host())
+	{
+		copy_image_region_h2h(out, 0, 0, full, x0, y0, out.dim());
+		return;
+	}
+	full = alloc_untyped_access<ImageUntypedAccess<DataInterpretationLayered> >(dim(), out.elem_kind(), true);  // true = on_host
+	copy_to_layered(full);
+	copy_image_region_h2h(out, 0, 0, full, x0, y0, out.dim());
+	void *data = full.data();
+	HostAllocator::free(data);
+}
+
+
+inline void BaseImage::copy_region_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in, int x0, int y0)
+{
+	ImageUntypedAccess<DataInterpretationLayered> full;
+	if (get_layered_view(&full) && full.is_on_host())
+	{
+		copy_image_region_h2h(full, x0, y0, in, 0, 0, in.dim());
+		return;
+	}
+	full = alloc_untyped_access<ImageUntypedAccess<DataInterpretationLayered> >(dim(), in.elem_kind(), true);  // true = on_host
+	copy_to_layered(full);
+	copy_image_region_h2h(full, x0, y0, in, 0, 0, in.dim());
+	copy_from_layered(full);
+	void *data = full.data();
+	HostAllocator::free(data);
+}
+
+
 template<typename T, typename DataInterpretation>
 class ImageManagerBase
 {
@@ -53,6 +97,8 @@ public:
 	virtual void setzero(ImageAccess<T, DataInterpretation> image) = 0;
 	virtual size_t alloc(ImageAccess<T, DataInterpretation> &image, const ArrayDim &dim) = 0;
 	virtual void free(ImageAccess<T, DataInterpretation> &image) = 0;
+	virtual size_t alloc_size(const ArrayDim &dim) = 0;  // bytes taken from the allocator by alloc() for dim
+	virtual bool is_on_host() = 0;
 };
 
 template<typename T, typename DataInterpretation, typename Allocator = HostAllocator>
@@ -98,8 +144,13 @@ public:
 		if (image.is_valid()) { allocator_t::free(image.data()); }
 	}
 
-private:
-	bool is_on_host() { return types_equal<allocator_t, HostAllocator>::value; }
+	virtual size_t alloc_size(const ArrayDim &dim)
+	{
+		DataDim data_dim = ImageAccess<T, DataInterpretation>::data_interpretation_t::used_data_dim(dim, sizeof(T));
+		return allocator_t::alloc_size(&data_dim);
+	}
+
+	virtual bool is_on_host() { return allocator_t::on_host(); }
 };
 
 
@@ -118,7 +169,7 @@ public:
 	ManagedImage() : is_owner(true) {}
 	ManagedImage(const ArrayDim &dim) : is_owner(true) { alloc(dim); }
 	ManagedImage(elem_t *data, const ArrayDim &dim) : array(data, dim, is_on_host()), is_owner(false) {}
-	ManagedImage(elem_t *data, const ArrayDim &dim, size_t pitch) : array(data, dim, pitch, ElemType2Kind<T>::value, is_on_host()), is_owner(false) {}
+	ManagedImage(elem_t *data, const ArrayDim &dim, size_t pitch) : array(ImageData(data, dim, pitch), is_on_host()), is_owner(false) {}
 	ManagedImage(const Self& other) : is_owner(true)
 	{
 		// copy
@@ -158,17 +209,40 @@ public:
 	{
 		image_manager.setzero(array);
 	}
+	// exchange the data with other, without copying
+	void swap(Self &other)
+	{
+		std::swap(array, other.array);
+		std::swap(is_owner, other.is_owner);
+	}
 
 	typename image_access_t::image_untyped_access_t get_untyped_access() { return array.get_untyped_access(); }
 	image_access_t& get_access() { return array; }
 	const image_access_t& get_access() const { return array; }
 	virtual ArrayDim dim() const { return array.dim(); }
 	virtual BaseImage* new_of_same_type_and_size() const { return new Self(dim()); }
+	virtual BaseImage* new_of_same_type(const ArrayDim &dim) const { return new Self(dim); }
 	virtual void copy_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in) { copy_image(this->array.get_untyped_access(), in); }
 	virtual void copy_to_layered(ImageUntypedAccess<DataInterpretationLayered> out) const { copy_image(out, this->array.get_untyped_access()); }
+	virtual bool get_layered_view(ImageUntypedAccess<DataInterpretationLayered> *view) const
+	{
+		if (!types_equal<data_interpretation_t, DataInterpretationLayered>::value || !array.is_valid()) { return false; }
+		*view = ImageUntypedAccess<DataInterpretationLayered>(ImageData(const_cast<void*>(array.const_data()), array.dim(), array.data_pitch()), ElemType2Kind<T>::value, is_on_host());
+		return true;
+	}
+	virtual void copy_region_to_layered(ImageUntypedAccess<DataInterpretationLayered> out, int x0, int y0) const
+	{
+		if (!is_on_host()) { BaseImage::copy_region_to_layered(out, x0, y0); return; }
+		copy_image_region_h2h(out, 0, 0, this->array.get_untyped_access(), x0, y0, out.dim());
+	}
+	virtual void copy_region_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in, int x0, int y0)
+	{
+		if (!is_on_host()) { BaseImage::copy_region_from_layered(in, x0, y0); return; }
+		copy_image_region_h2h(this->array.get_untyped_access(), x0, y0, in, 0, 0, in.dim());
+	}
 
 private:
-	static bool is_on_host() { return types_equal<allocator_t, HostAllocator>::value; }
+	static bool is_on_host() { return allocator_t::on_host(); }
 
 	image_manager_t image_manager;
 	image_access_t array;
@@ -176,5 +250,147 @@ private:
 };
 
 
+// Caller-owned host image with arbitrary strides in bytes, e.g. a numpy array or a cv::Mat region, used without copying:
+//   element (x, y, i) is at  data + x * x_stride + y * y_stride + i * channel_stride.
+// If the layout is layered (x_stride = sizeof(T) and channel_stride = h * y_stride), the solver reads its input directly from the data.
+// Otherwise the input is copied with the strides, which is still one copy less than going through an intermediate image.
+// new_of_same_type_and_size() and new_of_same_type() return a ManagedImage<T, DataInterpretationLayered>.
+template<typename T>
+class StridedImage: public BaseImage
+{
+public:
+	typedef T elem_t;
+
+	StridedImage(elem_t *data, const ArrayDim &dim, size_t x_stride, size_t y_stride, size_t channel_stride) :
+		data(data), dim_(dim), x_stride(x_stride), y_stride(y_stride), channel_stride(channel_stride) {}
+	virtual ~StridedImage() {}
+
+	virtual ArrayDim dim() const { return dim_; }
+	virtual BaseImage* new_of_same_type_and_size() const { return new ManagedImage<elem_t, DataInterpretationLayered>(dim_); }
+	virtual BaseImage* new_of_same_type(const ArrayDim &dim) const { return new ManagedImage<elem_t, DataInterpretationLayered>(dim); }
+	virtual void copy_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in)
+	{
+		if (!in.is_on_host())
+		{
+			ManagedImage<elem_t, DataInterpretationLayered> in_host(in.dim());
+			copy_image(in_host.get_untyped_access(), in);
+			copy_from_layered(in_host.get_untyped_access());
+			return;
+		}
+		copy_region_from_layered(in, 0, 0);
+	}
+	virtual void copy_to_layered(ImageUntypedAccess<DataInterpretationLayered> out) const
+	{
+		if (!out.is_on_host())
+		{
+			ManagedImage<elem_t, DataInterpretationLayered> out_host(dim_);
+			copy_to_layered(out_host.get_untyped_access());
+			copy_image(out, out_host.get_untyped_access());
+			return;
+		}
+		copy_region_to_layered(out, 0, 0);
+	}
+	virtual void copy_region_to_layered(ImageUntypedAccess<DataInterpretationLayered> out, int x0, int y0) const
+	{
+		const ArrayDim dim = out.dim();
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp parallel for
+#endif
+		for (int y = 0; y < dim.h; y++)
+		{
+			for (int i = 0; i < dim.num_channels; i++)
+			{
+				for (int x = 0; x < dim.w; x++) { convert_type(out.elem_kind(), ElemType2Kind<elem_t>::value, out.get_address(x, y, i), address(x0 + x, y0 + y, i)); }
+			}
+		}
+	}
+	virtual void copy_region_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in, int x0, int y0)
+	{
+		const ArrayDim dim = in.dim();
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+		#pragma omp parallel for
+#endif
+		for (int y = 0; y < dim.h; y++)
+		{
+			for (int i = 0; i < dim.num_channels; i++)
+			{
+				for (int x = 0; x < dim.w; x++) { convert_type(ElemType2Kind<elem_t>::value, in.elem_kind(), address(x0 + x, y0 + y, i), in.get_address(x, y, i)); }
+			}
+		}
+	}
+	virtual bool get_layered_view(ImageUntypedAccess<DataInterpretationLayered> *view) const
+	{
+		if (x_stride != sizeof(elem_t) || (dim_.num_channels > 1 && channel_stride != (size_t)dim_.h * y_stride)) { return false; }
+		*view = ImageUntypedAccess<DataInterpretationLayered>(ImageData((void*)data, dim_, y_stride), ElemType2Kind<elem_t>::value, true);  // true = on_host
+		return true;
+	}
+
+private:
+	void* address(int x, int y, int i) const { return (void*)((char*)data + x * x_stride + y * y_stride + i * channel_stride); }
+
+	elem_t *data;
+	ArrayDim dim_;
+	size_t x_stride;
+	size_t y_stride;
+	size_t channel_stride;
+};
+
+
+// The rectangle of size dim at (x0, y0) of another image, e.g. to solve only a part of it.
+// Reading and writing go through copy_region_to_layered() and copy_region_from_layered() of the image, so only the region is copied.
+// Constructed from a const image, the region is read-only.
+class RegionImage: public BaseImage
+{
+public:
+	RegionImage(const BaseImage *image, int x0, int y0, const ArrayDim &dim) : image(image), writable_image(NULL), x0(x0), y0(y0), dim_(dim) {}
+	RegionImage(BaseImage *image, int x0, int y0, const ArrayDim &dim) : image(image), writable_image(image), x0(x0), y0(y0), dim_(dim) {}
+	virtual ~RegionImage() {}
+
+	virtual ArrayDim dim() const { return dim_; }
+	virtual BaseImage* new_of_same_type_and_size() const { return image->new_of_same_type(dim_); }
+	virtual BaseImage* new_of_same_type(const ArrayDim &dim) const { return image->new_of_same_type(dim); }
+	virtual void copy_to_layered(ImageUntypedAccess<DataInterpretationLayered> out) const
+	{
+		if (out.is_on_host()) { copy_region_to_layered(out, 0, 0); return; }
+		ImageUntypedAccess<DataInterpretationLayered> out_host = alloc_untyped_access<ImageUntypedAccess<DataInterpretationLayered> >(dim_, out.elem_kind(), true);  // true = on_host
+		copy_region_to_layered(out_host, 0, 0);
+		copy_image(out, out_host);
+		void *data = out_host.data();
+		HostAllocator::free(data);
+	}
+	virtual void copy_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in)
+	{
+		if (in.is_on_host()) { copy_region_from_layered(in, 0, 0); return; }
+		ImageUntypedAccess<DataInterpretationLayered> in_host = alloc_untyped_access<ImageUntypedAccess<DataInterpretationLayered> >(dim_, in.elem_kind(), true);  // true = on_host
+		copy_image(in_host, in);
+		copy_region_from_layered(in_host, 0, 0);
+		void *data = in_host.data();
+		HostAllocator::free(data);
+	}
+	virtual void copy_region_to_layered(ImageUntypedAccess<DataInterpretationLayered> out, int x, int y) const { image->copy_region_to_layered(out, x0 + x, y0 + y); }
+	virtual void copy_region_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in, int x, int y)
+	{
+		if (!writable_image) { std::cerr << "ERROR: RegionImage::copy_region_from_layered(): The region of a const image is read-only" << std::endl; return; }
+		writable_image->copy_region_from_layered(in, x0 + x, y0 + y);
+	}
+	virtual bool get_layered_view(ImageUntypedAccess<DataInterpretationLayered> *view) const
+	{
+		// only with one channel, the region of a layered image is layered
+		ImageUntypedAccess<DataInterpretationLayered> image_view;
+		if (dim_.num_channels != 1 || !image->get_layered_view(&image_view)) { return false; }
+		void *data = image_view.get_address(x0, y0, 0);
+		*view = ImageUntypedAccess<DataInterpretationLayered>(ImageData(data, dim_, image_view.data_pitch()), image_view.elem_kind(), image_view.is_on_host());
+		return true;
+	}
+
+private:
+	const BaseImage *image;
+	BaseImage *writable_image;
+	int x0;
+	int y0;
+	ArrayDim dim_;
+};
+
+
 
 #endif // UTIL_IMAGE_H
@@ -23,6 +23,7 @@
 #include <cstring>  // for memset, memcpy
 #include "real.h"
 #include "types_equal.h"
+#include "mem_pool.h"
 #include <ostream>
 
 #ifndef DISABLE_CUDA
@@ -94,6 +95,8 @@ inline std::ostream& operator<< (std::ostream &out, const ArrayDim &dim)
 class HostAllocator
 {
 public:
+	static bool on_host() { return true; }
+	static size_t alloc_size(const DataDim *used_data_dim) { return used_data_dim->num_bytes(); }
 	static void free(void *&ptr) { delete[] (char*)ptr; ptr = NULL; }
 	static void setzero(void *ptr, size_t num_bytes) { memset(ptr, 0, num_bytes); }
 	static void* alloc2d(DataDim *used_data_dim)
@@ -120,10 +123,25 @@ public:
 };
 
 
+// Host allocator for the solver arrays, using the process-wide MemPool instead of new[] and delete[]
+class HostPoolAllocator: public HostAllocator
+{
+public:
+	static size_t alloc_size(const DataDim *used_data_dim) { return MemPool::alloc_size(used_data_dim->num_bytes()); }
+	static void free(void *&ptr) { MemPool::free(ptr); ptr = NULL; }
+	static void* alloc2d(DataDim *used_data_dim)
+	{
+		return MemPool::alloc(used_data_dim->num_bytes());
+	}
+};
+
+
 #ifndef DISABLE_CUDA
 class DeviceAllocator
 {
 public:
+	static bool on_host() { return false; }
+	static size_t alloc_size(const DataDim *used_data_dim) { return used_data_dim->num_bytes(); }  // without the padding of cudaMallocPitch
 	static void free(void *&ptr_cuda) { cudaFree(ptr_cuda); ptr_cuda = NULL; }
 	static void setzero(void *ptr_cuda, size_t num_bytes)
 	{
@@ -53,6 +53,28 @@ void copy_image_h2h_base(TUntypedAccessOut out, TUntypedAccessIn in)
 }
 
 
+// Copies the region of size dim at (in_x0, in_y0) of in to (out_x0, out_y0) of out, both on the host
+template<typename TUntypedAccessOut, typename TUntypedAccessIn>
+void copy_image_region_h2h(TUntypedAccessOut out, int out_x0, int out_y0, TUntypedAccessIn in, int in_x0, int in_y0, const ArrayDim &dim)
+{
+	const ElemKind out_kind = out.elem_kind();
+	const ElemKind in_kind = in.elem_kind();
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	#pragma omp parallel for
+#endif
+	for (int y = 0; y < dim.h; y++)
+	{
+		for (int i = 0; i < dim.num_channels; i++)
+		{
+			for (int x = 0; x < dim.w; x++)
+			{
+				convert_type(out_kind, in_kind, out.get_address(out_x0 + x, out_y0 + y, i), in.get_address(in_x0 + x, in_y0 + y, i));
+			}
+		}
+	}
+}
+
+
 template<typename TUntypedAccessOut, typename TUntypedAccessIn>
 void copy_image_h2h(TUntypedAccessOut out, TUntypedAccessIn in)
 {
@@ -0,0 +1,150 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "image_mapped.h"
+
+#include <cstring>
+#include <climits>
+#include <limits>
+
+
+
+namespace
+{
+
+const size_t page_size = 4096;
+const unsigned int format_version = 1;
+
+size_t data_offset_for_header()
+{
+	return (sizeof(MappedImageHeader) + page_size - 1) / page_size * page_size;
+}
+
+// Checks the sizes of a header read from a file: each one must be > 0 and fit into an int, and the number of data bytes into a size_t
+bool is_valid_size(const MappedImageHeader &header)
+{
+	const unsigned int sizes[3] = { header.w, header.h, header.num_channels };
+	size_t num_bytes = ElemKindGeneral::size((ElemKind)header.elem_kind);
+	for (int k = 0; k < 3; k++)
+	{
+		if (sizes[k] == 0 || sizes[k] > (unsigned int)INT_MAX || num_bytes > std::numeric_limits<size_t>::max() / sizes[k]) { return false; }
+		num_bytes *= sizes[k];
+	}
+	return true;
+}
+
+} // namespace
+
+
+
+bool MappedImage::open(const std::string &path, bool writable)
+{
+	close();
+	if (!file.open(path, writable)) { return false; }
+	MappedImageHeader header;
+	if (file.size() < sizeof(header)) { std::cerr << "ERROR: MappedImage::open(): " << path << " is too small for the header" << std::endl; close(); return false; }
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, "FMSI", 4) != 0) { std::cerr << "ERROR: MappedImage::open(): " << path << " is not an .fmsi image" << std::endl; close(); return false; }
+	if (header.version != format_version || header.layout != 0 || header.elem_kind > (unsigned int)elem_kind_double)
+	{
+		std::cerr << "ERROR: MappedImage::open(): Unsupported version " << header.version << ", layout " << header.layout << " or elem kind " << header.elem_kind << " in " << path << std::endl;
+		close();
+		return false;
+	}
+	if (!is_valid_size(header))
+	{
+		std::cerr << "ERROR: MappedImage::open(): Invalid image size " << header.w << " x " << header.h << " x " << header.num_channels << " in " << path << std::endl;
+		close();
+		return false;
+	}
+	ArrayDim dim(header.w, header.h, header.num_channels);
+	ElemKind kind = (ElemKind)header.elem_kind;
+	size_t pitch = (size_t)dim.w * ElemKindGeneral::size(kind);
+	if (header.data_offset > file.size() || pitch * dim.h * dim.num_channels > file.size() - header.data_offset)
+	{
+		std::cerr << "ERROR: MappedImage::open(): " << path << " is too small for an image of size " << dim << std::endl;
+		close();
+		return false;
+	}
+	data = ImageUntypedAccess<DataInterpretationLayered>(ImageData((char*)file.data() + header.data_offset, dim, pitch), kind, true);  // true = on_host
+	return true;
+}
+
+
+bool MappedImage::create(const std::string &path, const ArrayDim &dim, ElemKind elem_kind)
+{
+	close();
+	size_t pitch = (size_t)dim.w * ElemKindGeneral::size(elem_kind);
+	size_t data_offset = data_offset_for_header();
+	if (!file.create(path, data_offset + pitch * dim.h * dim.num_channels)) { return false; }
+	MappedImageHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "FMSI", 4);
+	header.version = format_version;
+	header.w = dim.w;
+	header.h = dim.h;
+	header.num_channels = dim.num_channels;
+	header.elem_kind = (unsigned int)elem_kind;
+	header.layout = 0;
+	header.data_offset = data_offset;
+	memcpy(file.data(), &header, sizeof(header));
+	data = ImageUntypedAccess<DataInterpretationLayered>(ImageData((char*)file.data() + data_offset, dim, pitch), elem_kind, true);  // true = on_host
+	return true;
+}
+
+
+void MappedImage::close()
+{
+	file.close();
+	data = ImageUntypedAccess<DataInterpretationLayered>();
+}
+
+
+BaseImage* MappedImage::new_of_same_type(const ArrayDim &dim) const
+{
+	switch (elem_kind())
+	{
+		case elem_kind_uchar: return new ManagedImage<unsigned char, DataInterpretationLayered>(dim);
+		case elem_kind_float: return new ManagedImage<float, DataInterpretationLayered>(dim);
+		default: return new ManagedImage<double, DataInterpretationLayered>(dim);
+	}
+}
+
+
+void MappedImage::copy_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in)
+{
+	if (!file.is_writable()) { std::cerr << "ERROR: MappedImage::copy_from_layered(): The file is opened read-only" << std::endl; return; }
+	copy_image(data, in);
+}
+
+
+void MappedImage::copy_region_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in, int x0, int y0)
+{
+	if (!file.is_writable()) { std::cerr << "ERROR: MappedImage::copy_region_from_layered(): The file is opened read-only" << std::endl; return; }
+	copy_image_region_h2h(data, x0, y0, in, 0, 0, in.dim());
+}
+
+
+bool MappedImage::get_layered_view(ImageUntypedAccess<DataInterpretationLayered> *view) const
+{
+	if (!data.is_valid()) { return false; }
+	*view = data;
+	return true;
+}
@@ -0,0 +1,84 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef UTIL_IMAGE_MAPPED_H
+#define UTIL_IMAGE_MAPPED_H
+
+#include "image.h"
+#include "mapped_file.h"
+
+
+
+// Header of the binary image file format (.fmsi) used by MappedImage.
+// The data follows at data_offset (a multiple of 4096 bytes) in the layered layout, with rows of w * elem size bytes.
+struct MappedImageHeader
+{
+	char magic[4];  // "FMSI"
+	unsigned int version;
+	unsigned int w;
+	unsigned int h;
+	unsigned int num_channels;
+	unsigned int elem_kind;  // ElemKind
+	unsigned int layout;  // 0 = layered
+	unsigned int reserved;
+	unsigned long long data_offset;
+};
+
+
+// Image stored in a memory-mapped .fmsi file, for images larger than the memory.
+// The data is read and written directly in the file, only the accessed pages are kept in memory by the operating system.
+// As input of Solver (with the elem type of the computation) it is used without a copy, see get_layered_view().
+// For images which do not fit into memory, use TiledSolver (solver/solver_tiled.h), with a writable MappedImage as output.
+class MappedImage: public BaseImage
+{
+public:
+	MappedImage() {}
+	virtual ~MappedImage() {}
+
+	// Opens an existing file, read-only or writable. Returns false on error.
+	bool open(const std::string &path, bool writable = false);
+
+	// Creates a new file for an image of size dim, set to zero. Returns false on error.
+	bool create(const std::string &path, const ArrayDim &dim, ElemKind elem_kind);
+
+	void close();
+	bool is_open() const { return file.is_open(); }
+	ElemKind elem_kind() const { return data.elem_kind(); }
+
+	// new_of_same_type_and_size() and new_of_same_type() return an in-memory ManagedImage with the same elem type.
+	virtual BaseImage* new_of_same_type_and_size() const { return new_of_same_type(dim()); }
+	virtual BaseImage* new_of_same_type(const ArrayDim &dim) const;
+	virtual ArrayDim dim() const { return data.dim(); }
+	virtual void copy_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in);
+	virtual void copy_to_layered(ImageUntypedAccess<DataInterpretationLayered> out) const { copy_image(out, data); }
+	virtual bool get_layered_view(ImageUntypedAccess<DataInterpretationLayered> *view) const;
+	virtual void copy_region_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in, int x0, int y0);
+
+private:
+	MappedImage(const MappedImage &other_image);  // disable
+	MappedImage& operator= (const MappedImage &other_image);  // disable
+
+	MappedFile file;
+	ImageUntypedAccess<DataInterpretationLayered> data;
+};
+
+
+
+#endif // UTIL_IMAGE_MAPPED_H
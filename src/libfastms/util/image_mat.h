@@ -45,9 +45,19 @@ public:
 	virtual ~MatImage() {}
 
 	virtual BaseImage* new_of_same_type_and_size() const { return new MatImage(dim(), mat.depth()); }
+	virtual BaseImage* new_of_same_type(const ArrayDim &dim) const { return new MatImage(dim, mat.depth()); }
 	virtual ArrayDim dim() const { return ArrayDim(mat.cols, mat.rows, mat.channels()); }
 	virtual void copy_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in) { copy_image(this->get_untyped_access(), in); }
 	virtual void copy_to_layered(ImageUntypedAccess<DataInterpretationLayered> out) const { copy_image(out, this->get_untyped_access()); }
+	virtual bool get_layered_view(ImageUntypedAccess<DataInterpretationLayered> *view) const
+	{
+		// with one channel, the interlaced layout of cv::Mat is the layered one
+		if (mat.channels() != 1) { return false; }
+		*view = ImageUntypedAccess<DataInterpretationLayered>(ImageData(get_data(), dim(), mat.step[0]), elem_kind(), true);  // true = on_host
+		return true;
+	}
+	virtual void copy_region_to_layered(ImageUntypedAccess<DataInterpretationLayered> out, int x0, int y0) const { copy_image_region_h2h(out, 0, 0, this->get_untyped_access(), x0, y0, out.dim()); }
+	virtual void copy_region_from_layered(const ImageUntypedAccess<DataInterpretationLayered> &in, int x0, int y0) { copy_image_region_h2h(this->get_untyped_access(), x0, y0, in, 0, 0, in.dim()); }
 
 	cv::Mat get_mat() const { return mat; }
 
@@ -55,7 +65,7 @@ private:
 	typedef ImageUntypedAccess<DataInterpretationInterlacedReversed> image_untyped_access_t;
 	image_untyped_access_t get_untyped_access() const
 	{
-		return image_untyped_access_t(get_data(), dim(), elem_kind(), true);  // true = on_host
+		return image_untyped_access_t(ImageData(get_data(), dim(), mat.step[0]), elem_kind(), true);  // true = on_host, with the row pitch of the cv::Mat (e.g. for regions)
 	}
 
 	void* get_data() const { return (void*)mat.data; }
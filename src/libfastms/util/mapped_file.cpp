@@ -0,0 +1,139 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "mapped_file.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // _WIN32
+
+
+
+MappedFile::MappedFile() : data_(NULL), size_(0), writable_(false), file_handle(NULL), mapping_handle(NULL) {}
+
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+
+bool MappedFile::open(const std::string &path, bool writable)
+{
+	return map(path, writable, false, 0);
+}
+
+
+bool MappedFile::create(const std::string &path, size_t num_bytes)
+{
+	return map(path, true, true, num_bytes);
+}
+
+
+#ifdef _WIN32
+
+bool MappedFile::map(const std::string &path, bool writable, bool create_new, size_t num_bytes)
+{
+	close();
+	HANDLE file = CreateFileA(path.c_str(), (writable? GENERIC_READ | GENERIC_WRITE : GENERIC_READ), FILE_SHARE_READ, NULL,
+			(create_new? CREATE_ALWAYS : OPEN_EXISTING), FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) { std::cerr << "ERROR: MappedFile: Could not open " << path << std::endl; return false; }
+	if (!create_new)
+	{
+		LARGE_INTEGER file_size;
+		GetFileSizeEx(file, &file_size);
+		num_bytes = (size_t)file_size.QuadPart;
+	}
+	if (num_bytes == 0) { std::cerr << "ERROR: MappedFile: Empty file " << path << std::endl; CloseHandle(file); return false; }
+	HANDLE mapping = CreateFileMappingA(file, NULL, (writable? PAGE_READWRITE : PAGE_READONLY),
+			(DWORD)((unsigned long long)num_bytes >> 32), (DWORD)(num_bytes & 0xffffffff), NULL);
+	void *data = (mapping? MapViewOfFile(mapping, (writable? FILE_MAP_WRITE : FILE_MAP_READ), 0, 0, num_bytes) : NULL);
+	if (!data)
+	{
+		std::cerr << "ERROR: MappedFile: Could not map " << path << std::endl;
+		if (mapping) { CloseHandle(mapping); }
+		CloseHandle(file);
+		return false;
+	}
+	data_ = data;
+	size_ = num_bytes;
+	writable_ = writable;
+	file_handle = (void*)file;
+	mapping_handle = (void*)mapping;
+	return true;
+}
+
+
+void MappedFile::close()
+{
+	if (!data_) { return; }
+	UnmapViewOfFile(data_);
+	CloseHandle((HANDLE)mapping_handle);
+	CloseHandle((HANDLE)file_handle);
+	data_ = NULL;
+	size_ = 0;
+	file_handle = NULL;
+	mapping_handle = NULL;
+}
+
+#else
+
+bool MappedFile::map(const std::string &path, bool writable, bool create_new, size_t num_bytes)
+{
+	close();
+	int fd = ::open(path.c_str(), (create_new? O_RDWR | O_CREAT | O_TRUNC : (writable? O_RDWR : O_RDONLY)), 0644);
+	if (fd < 0) { std::cerr << "ERROR: MappedFile: Could not open " << path << std::endl; return false; }
+	if (create_new)
+	{
+		if (ftruncate(fd, (off_t)num_bytes) != 0) { std::cerr << "ERROR: MappedFile: Could not resize " << path << " to " << num_bytes << " bytes" << std::endl; ::close(fd); return false; }
+	}
+	else
+	{
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) != 0) { std::cerr << "ERROR: MappedFile: Could not get the size of " << path << std::endl; ::close(fd); return false; }
+		num_bytes = (size_t)file_stat.st_size;
+	}
+	if (num_bytes == 0) { std::cerr << "ERROR: MappedFile: Empty file " << path << std::endl; ::close(fd); return false; }
+	void *data = mmap(NULL, num_bytes, (writable? PROT_READ | PROT_WRITE : PROT_READ), MAP_SHARED, fd, 0);
+	::close(fd);  // the mapping keeps the file open
+	if (data == MAP_FAILED) { std::cerr << "ERROR: MappedFile: Could not map " << path << std::endl; return false; }
+	data_ = data;
+	size_ = num_bytes;
+	writable_ = writable;
+	return true;
+}
+
+
+void MappedFile::close()
+{
+	if (!data_) { return; }
+	munmap(data_, size_);
+	data_ = NULL;
+	size_ = 0;
+}
+
+#endif // _WIN32
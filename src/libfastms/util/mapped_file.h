@@ -0,0 +1,66 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef UTIL_MAPPED_FILE_H
+#define UTIL_MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+
+
+// A file mapped into memory, so that large images and volumes are paged in and out by the operating system
+// instead of being read and written as a whole.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Maps the whole existing file, read-only or writable. Returns false on error.
+	bool open(const std::string &path, bool writable);
+
+	// Creates the file with num_bytes bytes (overwriting an existing one) and maps it writable. Returns false on error.
+	bool create(const std::string &path, size_t num_bytes);
+
+	// Unmaps the file, writing back the changes.
+	void close();
+
+	bool is_open() const { return data_ != NULL; }
+	bool is_writable() const { return writable_; }
+	void* data() const { return data_; }
+	size_t size() const { return size_; }
+
+private:
+	MappedFile(const MappedFile &other_file);  // disable
+	MappedFile& operator= (const MappedFile &other_file);  // disable
+
+	bool map(const std::string &path, bool writable, bool create_new, size_t num_bytes);
+
+	void *data_;
+	size_t size_;
+	bool writable_;
+	void *file_handle;  // only used on Windows
+	void *mapping_handle;  // only used on Windows
+};
+
+
+
+#endif // UTIL_MAPPED_FILE_H
@@ -0,0 +1,214 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "mem_pool.h"
+
+#include <pthread.h>
+#include <vector>
+
+
+
+namespace
+{
+
+// Stored in front of each buffer. Its size keeps the alignment of new[] for the data behind it.
+struct BufferHeader
+{
+	size_t capacity;
+	int size_class;
+	unsigned long long stamp;  // when the buffer was freed, for the eviction order
+};
+const size_t header_bytes = 64;
+
+const size_t min_capacity = 4096;
+const int min_capacity_log2 = 10;  // min_capacity = 4 << 10
+const int num_size_classes = 4 * 64;
+const int max_class_steps = 4;  // reuse buffers of up to 2 times the requested size
+
+// Rounds num_bytes up to the next m * 2^e with m in {4, 5, 6, 7}, i.e. 4 size classes per power of 2
+int get_size_class(size_t num_bytes, size_t *capacity)
+{
+	if (num_bytes <= min_capacity) { *capacity = min_capacity; return 0; }
+	int e = 0;
+	while ((num_bytes >> e) >= 8) { e++; }
+	size_t m = (num_bytes + ((size_t)1 << e) - 1) >> e;
+	if (m == 8) { m = 4; e++; }
+	*capacity = m << e;
+	return 4 * (e - min_capacity_log2) + (int)(m - 4);
+}
+
+
+struct PoolState
+{
+	PoolState() : idle(num_size_classes), cur_stamp(0)
+	{
+		pthread_mutex_init(&mutex, NULL);
+		stats.max_bytes = (size_t)512 * 1024 * 1024;
+	}
+
+	void delete_buffer(BufferHeader *header) { delete[] (char*)header; }
+
+	// Releases the least recently freed idle buffer
+	void evict_oldest()
+	{
+		int best_class = -1;
+		int best_pos = -1;
+		for (int c = 0; c < num_size_classes; c++)
+		{
+			for (int i = 0; i < (int)idle[c].size(); i++)
+			{
+				if (best_class < 0 || idle[c][i]->stamp < idle[best_class][best_pos]->stamp) { best_class = c; best_pos = i; }
+			}
+		}
+		if (best_class < 0) { return; }
+		BufferHeader *header = idle[best_class][best_pos];
+		idle[best_class].erase(idle[best_class].begin() + best_pos);
+		stats.bytes_cached -= header->capacity;
+		stats.evictions++;
+		delete_buffer(header);
+	}
+
+	void release_all()
+	{
+		for (int c = 0; c < num_size_classes; c++)
+		{
+			for (int i = 0; i < (int)idle[c].size(); i++) { delete_buffer(idle[c][i]); }
+			idle[c].clear();
+		}
+		stats.bytes_cached = 0;
+	}
+
+	std::vector<std::vector<BufferHeader*> > idle;  // per size class, most recently freed last
+	unsigned long long cur_stamp;
+	MemPoolStats stats;
+	pthread_mutex_t mutex;
+};
+
+// never destroyed, so that solvers in static objects can still free their buffers at program exit
+PoolState& pool_state()
+{
+	static PoolState *state = new PoolState();
+	return *state;
+}
+
+} // namespace
+
+
+
+void* MemPool::alloc(size_t num_bytes)
+{
+	PoolState &state = pool_state();
+	size_t capacity = 0;
+	int size_class = get_size_class(num_bytes, &capacity);
+
+	pthread_mutex_lock(&state.mutex);
+	BufferHeader *header = NULL;
+	for (int c = size_class; c < num_size_classes && c <= size_class + max_class_steps && !header; c++)
+	{
+		if (!state.idle[c].empty())
+		{
+			header = state.idle[c].back();
+			state.idle[c].pop_back();
+			state.stats.bytes_cached -= header->capacity;
+		}
+	}
+	if (header) { state.stats.hits++; } else { state.stats.misses++; }
+	state.stats.bytes_in_use += (header? header->capacity : capacity);
+	pthread_mutex_unlock(&state.mutex);
+
+	if (!header)
+	{
+		header = (BufferHeader*)(new char[header_bytes + capacity]);
+		header->capacity = capacity;
+		header->size_class = size_class;
+	}
+	return (void*)((char*)header + header_bytes);
+}
+
+
+void MemPool::free(void *ptr)
+{
+	if (!ptr) { return; }
+	PoolState &state = pool_state();
+	BufferHeader *header = (BufferHeader*)((char*)ptr - header_bytes);
+
+	pthread_mutex_lock(&state.mutex);
+	state.stats.bytes_in_use -= header->capacity;
+	if (header->capacity > state.stats.max_bytes)
+	{
+		state.delete_buffer(header);
+	}
+	else
+	{
+		while (state.stats.bytes_cached + header->capacity > state.stats.max_bytes) { state.evict_oldest(); }
+		header->stamp = state.cur_stamp++;
+		state.idle[header->size_class].push_back(header);
+		state.stats.bytes_cached += header->capacity;
+	}
+	pthread_mutex_unlock(&state.mutex);
+}
+
+
+size_t MemPool::alloc_size(size_t num_bytes)
+{
+	size_t capacity = 0;
+	get_size_class(num_bytes, &capacity);
+	return header_bytes + capacity;
+}
+
+
+void MemPool::set_max_bytes(size_t max_bytes)
+{
+	PoolState &state = pool_state();
+	pthread_mutex_lock(&state.mutex);
+	state.stats.max_bytes = max_bytes;
+	while (state.stats.bytes_cached > state.stats.max_bytes) { state.evict_oldest(); }
+	pthread_mutex_unlock(&state.mutex);
+}
+
+
+void MemPool::release()
+{
+	PoolState &state = pool_state();
+	pthread_mutex_lock(&state.mutex);
+	state.release_all();
+	pthread_mutex_unlock(&state.mutex);
+}
+
+
+MemPoolStats MemPool::get_stats()
+{
+	PoolState &state = pool_state();
+	pthread_mutex_lock(&state.mutex);
+	MemPoolStats stats = state.stats;
+	pthread_mutex_unlock(&state.mutex);
+	return stats;
+}
+
+
+void MemPool::reset_stats()
+{
+	PoolState &state = pool_state();
+	pthread_mutex_lock(&state.mutex);
+	state.stats.hits = 0;
+	state.stats.misses = 0;
+	state.stats.evictions = 0;
+	pthread_mutex_unlock(&state.mutex);
+}
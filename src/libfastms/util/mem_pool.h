@@ -0,0 +1,69 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef UTIL_MEM_POOL_H
+#define UTIL_MEM_POOL_H
+
+#include <cstddef>
+
+
+
+// Statistics of the MemPool
+struct MemPoolStats
+{
+	MemPoolStats() : hits(0), misses(0), evictions(0), bytes_in_use(0), bytes_cached(0), max_bytes(0) {}
+
+	size_t hits;          // allocations served by an idle buffer of the pool
+	size_t misses;        // allocations which needed a fresh buffer
+	size_t evictions;     // idle buffers freed because of max_bytes
+	size_t bytes_in_use;  // capacity of all buffers currently handed out
+	size_t bytes_cached;  // capacity of all idle buffers kept in the pool
+	size_t max_bytes;     // upper bound for bytes_cached
+};
+
+
+// Process-wide pool of host buffers for the solver arrays, shared by all Solver and Solver3 instances, for float and double.
+// Freed buffers are kept and handed out again for later allocations of the same or up to 2 times smaller size,
+// so that a batch of images of different sizes does not allocate (and page fault) fresh memory for every image.
+// The buffer sizes are rounded up to size classes with 4 classes per power of 2, i.e. at most 25% overhead.
+// If the idle buffers would exceed max_bytes, the least recently freed ones are released to the system.
+// All methods are thread-safe.
+class MemPool
+{
+public:
+	static void* alloc(size_t num_bytes);
+	static void free(void *ptr);
+
+	// Bytes taken from the system for an allocation of num_bytes, i.e. rounded up to the size class.
+	static size_t alloc_size(size_t num_bytes);
+
+	// Upper bound for the memory kept in idle buffers, default 512 MB. Value 0 disables the pool.
+	static void set_max_bytes(size_t max_bytes);
+
+	// Releases all idle buffers to the system.
+	static void release();
+
+	static MemPoolStats get_stats();
+	static void reset_stats();  // hits, misses and evictions
+};
+
+
+
+#endif // UTIL_MEM_POOL_H
@@ -23,6 +23,7 @@
 //#include <ctime>
 #include <cstddef>
 #include <sys/time.h>
+#include <time.h>
 
 
 class Timer
@@ -47,14 +48,24 @@ public:
 		if (running) end();
 		return seconds;
 	}
+	// elapsed time since start() without stopping the timer
+	double get_elapsed()
+	{
+		return (running? get_cur_seconds() - time_start : seconds);
+	}
 private:
 	// this method accumulates the time spent in all threads as if they were running in parallel,
 	// so we can't use this if we compute something with OpenMP
 	// double get_cur_seconds() { return (double)clock() / CLOCKS_PER_SEC; }
 
-	// this gives the wall clock time, and works as expected with OpenMP
+	// this gives the wall clock time, and works as expected with OpenMP.
+	// a monotonic clock is used where available, since the wall clock may jump (e.g. by NTP adjustments)
 	double get_cur_seconds()
 	{
+#if defined(CLOCK_MONOTONIC)
+	    struct timespec cur_time_mono;
+	    if (!clock_gettime(CLOCK_MONOTONIC, &cur_time_mono)) { return (double)cur_time_mono.tv_sec + 1e-9 * (double)cur_time_mono.tv_nsec; }
+#endif
 	    struct timeval cur_time;
 	    if (gettimeofday(&cur_time, NULL)) { return 0.0; }
 	    return (double)cur_time.tv_sec + 1e-6 * (double)cur_time.tv_usec;
@@ -40,6 +40,10 @@ public:
 	virtual ArrayDim3 dim() const = 0;
 	virtual void copy_from_layered(const VolumeUntypedAccess<DataInterpretationLayered> &in) = 0;
 	virtual void copy_to_layered(VolumeUntypedAccess<DataInterpretationLayered> out) const = 0;
+
+	// If the data is stored in the layered layout (with any row pitch), sets view to it and returns true.
+	// The solver then reads its input directly from the view instead of copying it with copy_to_layered().
+	virtual bool get_layered_view(VolumeUntypedAccess<DataInterpretationLayered> *view) const { return false; }
 };
 
 
@@ -52,6 +56,8 @@ public:
 	virtual void setzero(VolumeAccess<T, DataInterpretation> volume) = 0;
 	virtual size_t alloc(VolumeAccess<T, DataInterpretation> &volume, const ArrayDim3 &dim) = 0;
 	virtual void free(VolumeAccess<T, DataInterpretation> &volume) = 0;
+	virtual size_t alloc_size(const ArrayDim3 &dim) = 0;  // bytes taken from the allocator by alloc() for dim
+	virtual bool is_on_host() = 0;
 };
 
 template<typename T, typename DataInterpretation, typename Allocator = HostAllocator3>
@@ -97,8 +103,13 @@ public:
 		if (volume.is_valid()) { allocator_t::free(volume.data()); }
 	}
 
-private:
-	bool is_on_host() { return types_equal<allocator_t, HostAllocator3>::value; }
+	virtual size_t alloc_size(const ArrayDim3 &dim)
+	{
+		DataDim3 data_dim = VolumeAccess<T, DataInterpretation>::data_interpretation_t::used_data_dim(dim, sizeof(T));
+		return allocator_t::alloc_size(&data_dim);
+	}
+
+	virtual bool is_on_host() { return allocator_t::on_host(); }
 };
 
 
@@ -117,7 +128,7 @@ public:
 	ManagedVolume() : is_owner(true) {}
 	ManagedVolume(const ArrayDim3 &dim) : is_owner(true) { alloc(dim); }
 	ManagedVolume(elem_t *data, const ArrayDim3 &dim) : array(data, dim, is_on_host()), is_owner(false) {}
-	ManagedVolume(elem_t *data, const ArrayDim3 &dim, size_t pitch) : array(data, dim, pitch, ElemType2Kind<T>::value, is_on_host()), is_owner(false) {}
+	ManagedVolume(elem_t *data, const ArrayDim3 &dim, size_t pitch) : array(VolumeData(data, dim, pitch), is_on_host()), is_owner(false) {}
 	ManagedVolume(const Self& other) : is_owner(true)
 	{
 		// copy
@@ -165,9 +176,15 @@ public:
 	virtual BaseVolume* new_of_same_type_and_size() const { return new Self(dim()); }
 	virtual void copy_from_layered(const VolumeUntypedAccess<DataInterpretationLayered> &in) { copy_volume(this->array.get_untyped_access(), in); }
 	virtual void copy_to_layered(VolumeUntypedAccess<DataInterpretationLayered> out) const { copy_volume(out, this->array.get_untyped_access()); }
+	virtual bool get_layered_view(VolumeUntypedAccess<DataInterpretationLayered> *view) const
+	{
+		if (!types_equal<data_interpretation_t, DataInterpretationLayered>::value || !array.is_valid()) { return false; }
+		*view = VolumeUntypedAccess<DataInterpretationLayered>(VolumeData(const_cast<void*>(array.const_data()), array.dim(), array.data_pitch()), ElemType2Kind<T>::value, is_on_host());
+		return true;
+	}
 
 private:
-	static bool is_on_host() { return types_equal<allocator_t, HostAllocator3>::value; }
+	static bool is_on_host() { return allocator_t::on_host(); }
 
 	volume_manager_t volume_manager;
 	volume_access_t array;
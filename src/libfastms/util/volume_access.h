@@ -23,6 +23,7 @@
 #include <cstring>  // for memset, memcpy
 #include "real.h"
 #include "types_equal.h"
+#include "mem_pool.h"
 #include <ostream>
 
 #ifndef DISABLE_CUDA
@@ -99,6 +100,8 @@ inline std::ostream& operator<< (std::ostream &out, const ArrayDim3 &dim)
 class HostAllocator3
 {
 public:
+	static bool on_host() { return true; }
+	static size_t alloc_size(const DataDim3 *used_data_dim) { return used_data_dim->num_bytes(); }
 	static void free(void *&ptr) { delete[] (char*)ptr; ptr = NULL; }
 	static void setzero(void *ptr, size_t num_bytes) { memset(ptr, 0, num_bytes); }
 	static void* alloc3d(DataDim3 *used_data_dim)
@@ -128,10 +131,25 @@ public:
 };
 
 
+// Host allocator for the solver arrays, using the process-wide MemPool instead of new[] and delete[]
+class HostPoolAllocator3: public HostAllocator3
+{
+public:
+	static size_t alloc_size(const DataDim3 *used_data_dim) { return MemPool::alloc_size(used_data_dim->num_bytes()); }
+	static void free(void *&ptr) { MemPool::free(ptr); ptr = NULL; }
+	static void* alloc3d(DataDim3 *used_data_dim)
+	{
+		return MemPool::alloc(used_data_dim->num_bytes());
+	}
+};
+
+
 #ifndef DISABLE_CUDA
 class DeviceAllocator3
 {
 public:
+	static bool on_host() { return false; }
+	static size_t alloc_size(const DataDim3 *used_data_dim) { return used_data_dim->num_bytes(); }  // without the padding of cudaMallocPitch
 	static void free(void *&ptr_cuda) { cudaFree(ptr_cuda); ptr_cuda = NULL; }
 	static void setzero(void *ptr_cuda, size_t num_bytes)
 	{
@@ -333,6 +351,63 @@ struct DataInterpretationInterlacedReversed
 
 
 
+// Bricked layout: The volume is divided into bricks of brick_size^3 voxels (padded at the upper borders), stored one after the other
+// in x, y, z order of the bricks, with all channels of a brick together. The 6-neighborhood of a voxel then lies mostly in the same brick
+// (2 KB per channel for float), instead of in three planes far apart. The data is addressed as one long row, DataIndex3(offset, 0, 0).
+struct DataInterpretationBricked
+{
+	static const int brick_shift = 3;
+	static const int brick_size = (1 << brick_shift);
+	static const int brick_volume = brick_size * brick_size * brick_size;
+
+	HOST_DEVICE static DataIndex3 get(int x, int y, int z, int i, const ArrayDim3 &dim)
+	{
+		const unsigned int mask = brick_size - 1;
+		const unsigned int bw = ((unsigned int)dim.w + mask) >> brick_shift;
+		const unsigned int bh = ((unsigned int)dim.h + mask) >> brick_shift;
+		const size_t brick = ((unsigned int)x >> brick_shift) + bw * (((unsigned int)y >> brick_shift) + (size_t)bh * ((unsigned int)z >> brick_shift));
+		const unsigned int in_brick = ((unsigned int)x & mask) | (((unsigned int)y & mask) << brick_shift) | (((unsigned int)z & mask) << (2 * brick_shift));
+		return DataIndex3(((brick * dim.num_channels + i) << (3 * brick_shift)) | in_brick, 0, 0);
+	}
+	HOST_DEVICE static DataDim3 used_data_dim (const ArrayDim3 &dim, size_t elem_size)
+	{
+		const size_t num_bricks = (size_t)((dim.w + brick_size - 1) >> brick_shift) * ((dim.h + brick_size - 1) >> brick_shift) * ((dim.d + brick_size - 1) >> brick_shift);
+		return DataDim3(num_bricks * brick_volume * dim.num_channels * elem_size, 1, 1);
+	}
+};
+
+
+// Division of a volume into the bricks of DataInterpretationBricked, as unit of iteration and parallel scheduling (for any layout)
+struct BrickGrid3
+{
+	HOST_DEVICE BrickGrid3(const Dim3D &dim3d) : dim3d(dim3d)
+	{
+		const int brick_size = DataInterpretationBricked::brick_size;
+		bw = (dim3d.w + brick_size - 1) / brick_size;
+		bh = (dim3d.h + brick_size - 1) / brick_size;
+		bd = (dim3d.d + brick_size - 1) / brick_size;
+	}
+	HOST_DEVICE int num_bricks() const { return bw * bh * bd; }
+
+	// voxels [x0, x1) x [y0, y1) x [z0, z1) of brick b
+	HOST_DEVICE void get_range(int b, int &x0, int &y0, int &z0, int &x1, int &y1, int &z1) const
+	{
+		const int brick_size = DataInterpretationBricked::brick_size;
+		x0 = (b % bw) * brick_size;
+		y0 = ((b / bw) % bh) * brick_size;
+		z0 = (b / (bw * bh)) * brick_size;
+		x1 = (x0 + brick_size < dim3d.w? x0 + brick_size : dim3d.w);
+		y1 = (y0 + brick_size < dim3d.h? y0 + brick_size : dim3d.h);
+		z1 = (z0 + brick_size < dim3d.d? z0 + brick_size : dim3d.d);
+	}
+
+	Dim3D dim3d;
+	int bw;
+	int bh;
+	int bd;
+};
+
+
 #undef HOST_DEVICE
 #undef FORCEINLINE
 
@@ -56,6 +56,41 @@ void copy_volume_h2h_base(TUntypedAccessOut out, TUntypedAccessIn in)
 }
 
 
+// whether the voxels of a brick row (DataInterpretationBricked) are contiguous in memory
+template<typename DataInterpretation> struct has_contiguous_brick_rows
+{
+	static const bool value = types_equal<DataInterpretation, DataInterpretationLayered>::value || types_equal<DataInterpretation, DataInterpretationBricked>::value;
+};
+
+
+// Same elem type, both layouts with contiguous brick rows (layered <-> bricked): copy brick by brick, one row of a brick at a time
+template<typename TUntypedAccessOut, typename TUntypedAccessIn>
+void copy_volume_h2h_brick_rows(TUntypedAccessOut out, TUntypedAccessIn in)
+{
+	const BrickGrid3 grid(in.dim().dim3d());
+	const int num_channels = in.dim().num_channels;
+	const size_t elem_size = ElemKindGeneral::size(in.elem_kind());
+#if !defined(DISABLE_OPENMP) && defined(_OPENMP)
+	#pragma omp parallel for
+#endif
+	for (int b = 0; b < grid.num_bricks(); b++)
+	{
+		int x0, y0, z0, x1, y1, z1;
+		grid.get_range(b, x0, y0, z0, x1, y1, z1);
+		for (int i = 0; i < num_channels; i++)
+		{
+			for (int z = z0; z < z1; z++)
+			{
+				for (int y = y0; y < y1; y++)
+				{
+					memcpy(out.get_address(x0, y, z, i), in.get_address(x0, y, z, i), (x1 - x0) * elem_size);
+				}
+			}
+		}
+	}
+}
+
+
 template<typename TUntypedAccessOut, typename TUntypedAccessIn>
 void copy_volume_h2h(TUntypedAccessOut out, TUntypedAccessIn in)
 {
@@ -64,6 +99,11 @@ void copy_volume_h2h(TUntypedAccessOut out, TUntypedAccessIn in)
 	{
 		HostAllocator3::copy3d(out.data(), out.data_pitch(), in.const_data(), in.data_pitch(), in.data_width_in_bytes(), in.data_height(), in.data_depth());
 	}
+	else if (out.elem_kind() == in.elem_kind() &&
+		has_contiguous_brick_rows<typename TUntypedAccessOut::data_interpretation_t>::value && has_contiguous_brick_rows<typename TUntypedAccessIn::data_interpretation_t>::value)
+	{
+		copy_volume_h2h_brick_rows(out, in);
+	}
 	else
 	{
 		copy_volume_h2h_base(out, in);
@@ -0,0 +1,148 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "volume_mapped.h"
+
+#include <cstring>
+#include <climits>
+#include <limits>
+
+
+
+namespace
+{
+
+const size_t page_size = 4096;
+const unsigned int format_version = 1;
+
+size_t data_offset_for_header()
+{
+	return (sizeof(MappedVolumeHeader) + page_size - 1) / page_size * page_size;
+}
+
+size_t data_num_bytes(const ArrayDim3 &dim, ElemKind elem_kind)
+{
+	return (size_t)dim.w * ElemKindGeneral::size(elem_kind) * dim.h * dim.d * dim.num_channels;
+}
+
+// Checks the sizes of a header read from a file: each one must be > 0 and fit into an int, and the number of data bytes into a size_t
+bool is_valid_size(const MappedVolumeHeader &header)
+{
+	const unsigned int sizes[4] = { header.w, header.h, header.d, header.num_channels };
+	size_t num_bytes = ElemKindGeneral::size((ElemKind)header.elem_kind);
+	for (int k = 0; k < 4; k++)
+	{
+		if (sizes[k] == 0 || sizes[k] > (unsigned int)INT_MAX || num_bytes > std::numeric_limits<size_t>::max() / sizes[k]) { return false; }
+		num_bytes *= sizes[k];
+	}
+	return true;
+}
+
+} // namespace
+
+
+
+bool MappedVolume::open(const std::string &path, bool writable)
+{
+	close();
+	if (!file.open(path, writable)) { return false; }
+	MappedVolumeHeader header;
+	if (file.size() < sizeof(header)) { std::cerr << "ERROR: MappedVolume::open(): " << path << " is too small for the header" << std::endl; close(); return false; }
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, "FMSV", 4) != 0) { std::cerr << "ERROR: MappedVolume::open(): " << path << " is not an .fmsv volume" << std::endl; close(); return false; }
+	if (header.version != format_version || header.layout != 0 || header.elem_kind > (unsigned int)elem_kind_double)
+	{
+		std::cerr << "ERROR: MappedVolume::open(): Unsupported version " << header.version << ", layout " << header.layout << " or elem kind " << header.elem_kind << " in " << path << std::endl;
+		close();
+		return false;
+	}
+	if (!is_valid_size(header))
+	{
+		std::cerr << "ERROR: MappedVolume::open(): Invalid volume size " << header.w << " x " << header.h << " x " << header.d << " x " << header.num_channels << " in " << path << std::endl;
+		close();
+		return false;
+	}
+	ArrayDim3 dim(header.w, header.h, header.d, header.num_channels);
+	ElemKind kind = (ElemKind)header.elem_kind;
+	if (header.data_offset % page_size != 0 || header.data_offset > file.size() || data_num_bytes(dim, kind) > file.size() - header.data_offset)
+	{
+		std::cerr << "ERROR: MappedVolume::open(): " << path << " is too small for a volume of size " << dim << ", or the data is not page-aligned" << std::endl;
+		close();
+		return false;
+	}
+	data = VolumeUntypedAccess<DataInterpretationLayered>((char*)file.data() + header.data_offset, dim, kind, true);  // true = on_host
+	return true;
+}
+
+
+bool MappedVolume::create(const std::string &path, const ArrayDim3 &dim, ElemKind elem_kind)
+{
+	close();
+	size_t data_offset = data_offset_for_header();
+	if (!file.create(path, data_offset + data_num_bytes(dim, elem_kind))) { return false; }
+	MappedVolumeHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "FMSV", 4);
+	header.version = format_version;
+	header.w = dim.w;
+	header.h = dim.h;
+	header.d = dim.d;
+	header.num_channels = dim.num_channels;
+	header.elem_kind = (unsigned int)elem_kind;
+	header.layout = 0;
+	header.data_offset = data_offset;
+	memcpy(file.data(), &header, sizeof(header));
+	data = VolumeUntypedAccess<DataInterpretationLayered>((char*)file.data() + data_offset, dim, elem_kind, true);  // true = on_host
+	return true;
+}
+
+
+void MappedVolume::close()
+{
+	file.close();
+	data = VolumeUntypedAccess<DataInterpretationLayered>();
+}
+
+
+BaseVolume* MappedVolume::new_of_same_type_and_size() const
+{
+	switch (elem_kind())
+	{
+		case elem_kind_uchar: return new ManagedVolume<unsigned char, DataInterpretationLayered>(dim());
+		case elem_kind_float: return new ManagedVolume<float, DataInterpretationLayered>(dim());
+		default: return new ManagedVolume<double, DataInterpretationLayered>(dim());
+	}
+}
+
+
+void MappedVolume::copy_from_layered(const VolumeUntypedAccess<DataInterpretationLayered> &in)
+{
+	if (!file.is_writable()) { std::cerr << "ERROR: MappedVolume::copy_from_layered(): The file is opened read-only" << std::endl; return; }
+	copy_volume(data, in);
+}
+
+
+bool MappedVolume::get_layered_view(VolumeUntypedAccess<DataInterpretationLayered> *view) const
+{
+	if (!data.is_valid()) { return false; }
+	*view = data;
+	return true;
+}
@@ -0,0 +1,84 @@
+/*
+* This file is part of fastms.
+*
+* Copyright 2014 Evgeny Strekalovskiy <evgeny dot strekalovskiy at in dot tum dot de> (Technical University of Munich)
+*
+* fastms is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* fastms is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with fastms. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef UTIL_VOLUME_MAPPED_H
+#define UTIL_VOLUME_MAPPED_H
+
+#include "volume.h"
+#include "mapped_file.h"
+#include <string>
+
+
+
+// Header of the binary volume file format (.fmsv) used by MappedVolume.
+// The data follows at data_offset (a multiple of 4096 bytes) in the layered layout:
+// rows of w * elem size bytes, h rows per slice, d slices per channel, one channel after the other.
+struct MappedVolumeHeader
+{
+	char magic[4];  // "FMSV"
+	unsigned int version;
+	unsigned int w;
+	unsigned int h;
+	unsigned int d;
+	unsigned int num_channels;
+	unsigned int elem_kind;  // ElemKind
+	unsigned int layout;  // 0 = layered
+	unsigned long long data_offset;
+};
+
+
+// Volume stored in a memory-mapped .fmsv file, for volumes which are too large to be read and parsed as a whole.
+// The data is read and written directly in the file, only the accessed pages are kept in memory by the operating system.
+// As input of Solver3 (with the elem type of the computation, on the CPU) it is used without a copy, see get_layered_view().
+class MappedVolume: public BaseVolume
+{
+public:
+	MappedVolume() {}
+	virtual ~MappedVolume() {}
+
+	// Opens an existing file, read-only or writable. Returns false on error.
+	bool open(const std::string &path, bool writable = false);
+
+	// Creates a new file for a volume of size dim, set to zero. Returns false on error.
+	bool create(const std::string &path, const ArrayDim3 &dim, ElemKind elem_kind);
+
+	void close();
+	bool is_open() const { return file.is_open(); }
+	ElemKind elem_kind() const { return data.elem_kind(); }
+
+	// new_of_same_type_and_size() returns an in-memory ManagedVolume with the same elem type.
+	virtual BaseVolume* new_of_same_type_and_size() const;
+	virtual ArrayDim3 dim() const { return data.dim(); }
+	virtual void copy_from_layered(const VolumeUntypedAccess<DataInterpretationLayered> &in);
+	virtual void copy_to_layered(VolumeUntypedAccess<DataInterpretationLayered> out) const { copy_volume(out, data); }
+	virtual bool get_layered_view(VolumeUntypedAccess<DataInterpretationLayered> *view) const;
+
+private:
+	MappedVolume(const MappedVolume &other_volume);  // disable
+	MappedVolume& operator= (const MappedVolume &other_volume);  // disable
+
+	MappedFile file;
+	VolumeUntypedAccess<DataInterpretationLayered> data;
+};
+
+
+
+#endif // UTIL_VOLUME_MAPPED_H
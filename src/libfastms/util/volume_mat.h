@@ -63,7 +63,7 @@ private:
 		return volume_untyped_access_t(get_data(), dim(), elem_kind(), true);  // true = on_host
 	}
 
-	void* get_data() const { return (void*)&mat.data; }
+	void* get_data() const { return (mat.data.empty()? NULL : (void*)&mat.data[0]); }
 	ElemKind elem_kind() const { return elem_kind_uchar; } // TODO: Dynamic typing
 
 	VolMat mat;
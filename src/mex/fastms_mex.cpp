@@ -31,9 +31,13 @@ Par parse_par(const mxArray *matrix)
 	matlab_get_scalar_field("lambda", par.lambda, matrix);
 	matlab_get_scalar_field("alpha", par.alpha, matrix);
 	matlab_get_scalar_field("temporal", par.temporal, matrix);
+	matlab_get_scalar_field("incremental", par.incremental, matrix);
+	matlab_get_scalar_field("incremental_eps", par.incremental_eps, matrix);
+	matlab_get_scalar_field("incremental_max_fraction", par.incremental_max_fraction, matrix);
 	matlab_get_scalar_field("iterations", par.iterations, matrix);
 	matlab_get_scalar_field("stop_eps", par.stop_eps, matrix);
 	matlab_get_scalar_field("stop_k", par.stop_k, matrix);
+	matlab_get_scalar_field("time_budget", par.time_budget, matrix);
 	matlab_get_scalar_field("adapt_params", par.adapt_params, matrix);
 	matlab_get_scalar_field("weight", par.weight, matrix);
 	matlab_get_scalar_field("use_double", par.use_double, matrix);
@@ -76,6 +76,15 @@ public:
 	}
 
 	virtual BaseImage* new_of_same_type_and_size() const { return new MatlabImage(get_dims(), get_class()); }
+	virtual BaseImage* new_of_same_type(const ArrayDim &dim) const
+	{
+		// h x w, and the channels as the last dimension
+		std::vector<mwSize> new_dims;
+		new_dims.push_back(dim.h);
+		new_dims.push_back(dim.w);
+		if (dim.num_channels > 1) { new_dims.push_back(dim.num_channels); }
+		return new MatlabImage(new_dims, get_class());
+	}
 	virtual ArrayDim dim() const
 	{
 		ArrayDim d;